@@ -0,0 +1,160 @@
+#include "aot.h"
+#include "parser.h"
+#include "exceptions.h"
+
+#include <sstream>
+
+static ValueType ApplyValues(const std::shared_ptr<Scope>& scope, const ValueType& function,
+                             ArgSpan args) {
+    if (function.GetType() != ValueType::ValueEnum::FUNC){
+        throw RuntimeError(function.ToString() + " is not self evaluating");
+    }
+    auto node = function.AsNode();
+    if (auto primitive = dynamic_cast<Primitive*>(node)){
+        return primitive->Apply(args);
+    }
+    if (auto func = dynamic_cast<Func*>(node)){
+        std::vector<NodePtr> nodes;
+        for (auto& arg : args){
+            nodes.push_back(NodeFromArgument(arg));
+        }
+        return func->Evaluate(ArgList(nodes), scope);
+    }
+    throw RuntimeError(node->ToString() + " is not self evaluating");
+}
+
+CompiledLambda::CompiledLambda(size_t arity, size_t frame_size, CompiledBody body,
+                               std::shared_ptr<Scope> scope) :
+        arity_(arity), frame_size_(frame_size), body_(body), scope_(std::move(scope)) {}
+
+std::shared_ptr<Scope> CompiledLambda::BindFrame(ArgSpan args) const {
+    if (args.size() != arity_){
+        throw RuntimeError("wrong number of arguments in function call");
+    }
+    auto frame = MakeScope(scope_, frame_size_);
+    for (size_t i = 0; i < args.size(); ++i){
+        frame->Slot(0, i) = args[i];
+    }
+    return frame;
+}
+
+ValueType CompiledLambda::Apply(ArgSpan args) {
+    auto frame = BindFrame(args);
+    CompiledLambda* lambda = this;
+    // keeps the lambda of the current tail call alive
+    ValueType callee;
+    AotTailCall tail;
+    while (true) {
+        GcSafepoint();
+        auto value = lambda->body_(frame, &tail);
+        if (tail.function.GetType() == ValueType::ValueEnum::UNDEFINED){
+            return value;
+        }
+        callee = tail.function;
+        tail.function = ValueType();
+        std::vector<ValueType> next_args;
+        next_args.swap(tail.args);
+        ArgSpan next(next_args.data(), next_args.size());
+        lambda = callee.GetType() == ValueType::ValueEnum::FUNC ?
+                 dynamic_cast<CompiledLambda*>(callee.AsNode()) : nullptr;
+        if (!lambda){
+            return ApplyValues(frame, callee, next);
+        }
+        frame = lambda->BindFrame(next);
+    }
+}
+
+bool CompiledLambda::IsClosure() const {
+    return true;
+}
+
+void CompiledLambda::Trace(Tracer* tracer) {
+    TraceScope(tracer, scope_);
+}
+
+void CompiledLambda::ClearReferences() {
+    scope_.reset();
+}
+
+ValueType AotCall(const std::shared_ptr<Scope>& scope, std::initializer_list<ValueType> call) {
+    return ApplyValues(scope, *call.begin(), ArgSpan(call.begin() + 1, call.size() - 1));
+}
+
+ValueType AotTail(AotTailCall* tail, std::initializer_list<ValueType> call) {
+    tail->function = *call.begin();
+    tail->args.assign(call.begin() + 1, call.end());
+    return ValueType();
+}
+
+ValueType AotGlobal(const std::shared_ptr<Scope>& scope, Symbol name) {
+    return scope->GetValue(name);
+}
+
+ValueType AotDefineGlobal(const std::shared_ptr<Scope>& scope, Symbol name,
+                          const ValueType& value) {
+    scope->AddName(name, value);
+    return AotEmpty();
+}
+
+ValueType AotSetGlobal(const std::shared_ptr<Scope>& scope, Symbol name,
+                       const ValueType& value) {
+    scope->SetValue(name, value);
+    return AotEmpty();
+}
+
+ValueType AotLocal(const std::shared_ptr<Scope>& scope, size_t depth, size_t index,
+                   const char* name) {
+    auto& value = scope->Slot(depth, index);
+    if (value.GetType() == ValueType::ValueEnum::UNDEFINED){
+        throw NameError(std::string("undefined name ") + name);
+    }
+    return value;
+}
+
+ValueType AotDefineLocal(const std::shared_ptr<Scope>& scope, size_t depth, size_t index,
+                         const ValueType& value) {
+    scope->StoreSlot(depth, index, value);
+    return AotEmpty();
+}
+
+ValueType AotSetLocal(const std::shared_ptr<Scope>& scope, size_t depth, size_t index,
+                      const ValueType& value, const char* name) {
+    AotLocal(scope, depth, index, name);
+    scope->StoreSlot(depth, index, value);
+    return AotEmpty();
+}
+
+ValueType AotLambda(const std::shared_ptr<Scope>& scope, size_t arity, size_t frame_size,
+                    CompiledBody body) {
+    return ValueType(NodePtr(new CompiledLambda(arity, frame_size, body, scope)));
+}
+
+ValueType AotRead(const char* text) {
+    std::stringstream in(text);
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    return ValueFromNode(parser.Parse());
+}
+
+ValueType AotEmpty() {
+    return ValueType(NodePtr(new Empty()));
+}
+
+ValueType AotRaise(const char* message) {
+    throw RuntimeError(message);
+}
+
+int RunCompiledProgram(std::ostream* out, GcConfig gc_config) {
+    Heap heap(gc_config);
+    HeapScope heap_scope(&heap);
+    auto scope = MakeScope();
+    AddBuiltins(scope.get());
+    auto roots = heap.AddRoots([&scope](Tracer* tracer) {
+        TraceScope(tracer, scope);
+    });
+    CompiledProgram(scope, out);
+    // like ~Lispp, frees the cycles between the scope and its closures
+    heap.RemoveRoots(roots);
+    scope.reset();
+    heap.Collect();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "node_types.h"
+
+// Runtime for C++ code generated by CppEmitter (lispp --compile). A
+// compiled lambda body is a function of its frame; a call in tail position
+// stores the callee and its arguments in AotTailCall and the caller runs it
+// in a loop, so compiled tail calls do not grow the native stack.
+
+struct AotTailCall {
+    ValueType function;
+    std::vector<ValueType> args;
+};
+
+using CompiledBody = ValueType (*)(const std::shared_ptr<Scope>& scope, AotTailCall* tail);
+
+class CompiledLambda : public Primitive{
+public:
+    CompiledLambda(size_t arity, size_t frame_size, CompiledBody body,
+                   std::shared_ptr<Scope> scope);
+    ValueType Apply(ArgSpan args) override;
+    bool IsClosure() const override;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    size_t arity_;
+    size_t frame_size_;
+    CompiledBody body_;
+    std::shared_ptr<Scope> scope_;
+
+    std::shared_ptr<Scope> BindFrame(ArgSpan args) const;
+};
+
+// call is the callee followed by the arguments, all already evaluated
+ValueType AotCall(const std::shared_ptr<Scope>& scope, std::initializer_list<ValueType> call);
+
+ValueType AotTail(AotTailCall* tail, std::initializer_list<ValueType> call);
+
+ValueType AotGlobal(const std::shared_ptr<Scope>& scope, Symbol name);
+
+ValueType AotDefineGlobal(const std::shared_ptr<Scope>& scope, Symbol name,
+                          const ValueType& value);
+
+ValueType AotSetGlobal(const std::shared_ptr<Scope>& scope, Symbol name,
+                       const ValueType& value);
+
+ValueType AotLocal(const std::shared_ptr<Scope>& scope, size_t depth, size_t index,
+                   const char* name);
+
+ValueType AotDefineLocal(const std::shared_ptr<Scope>& scope, size_t depth, size_t index,
+                         const ValueType& value);
+
+ValueType AotSetLocal(const std::shared_ptr<Scope>& scope, size_t depth, size_t index,
+                      const ValueType& value, const char* name);
+
+ValueType AotLambda(const std::shared_ptr<Scope>& scope, size_t arity, size_t frame_size,
+                    CompiledBody body);
+
+// value of a quoted datum written as text
+ValueType AotRead(const char* text);
+
+ValueType AotEmpty();
+
+ValueType AotRaise(const char* message);
+
+// evaluates a top-level form and prints its value or error like the REPL
+template<class Form>
+void AotRunForm(std::ostream* out, Form form) {
+    try {
+        auto value_string = form().ToString();
+        if (value_string != "") {
+            (*out) << "     >> " << value_string << std::endl;
+        }
+    } catch (const std::exception& exception) {
+        (*out) << "     >> " << exception.what() << std::endl;
+    }
+    GcSafepoint();
+}
+
+// defined by the generated code
+void CompiledProgram(const std::shared_ptr<Scope>& scope, std::ostream* out);
+
+// runs CompiledProgram in a fresh global scope with the builtins, in a heap
+// of its own which is collected when the program ends
+int RunCompiledProgram(std::ostream* out = &std::cout, GcConfig gc_config = GcConfig());
@@ -0,0 +1,119 @@
+#include "bytecode.h"
+#include "exceptions.h"
+
+uint32_t CodeObject::Emit(OpCode op, uint32_t arg) {
+    code.push_back({op, 0, 0, arg});
+    return code.size() - 1;
+}
+
+uint32_t CodeObject::EmitLocal(OpCode op, const LocalVar& var) {
+    if (var.Depth() > UINT8_MAX || var.Index() > UINT16_MAX){
+        throw SyntaxError("too many nested variables for " + var.ToString());
+    }
+    code.push_back({op, static_cast<uint8_t>(var.Depth()),
+                    static_cast<uint16_t>(var.Index()), AddName(var.ToString())});
+    return code.size() - 1;
+}
+
+uint32_t CodeObject::AddConstant(const ValueType& value) {
+    constants.push_back(value);
+    return constants.size() - 1;
+}
+
+uint32_t CodeObject::AddName(const std::string& name) {
+    for (size_t i = 0; i < names.size(); ++i){
+        if (names[i] == name){
+            return i;
+        }
+    }
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+uint32_t CodeObject::AddGlobal(Symbol name) {
+    for (size_t i = 0; i < globals.size(); ++i){
+        if (globals[i] == name){
+            return i;
+        }
+    }
+    globals.push_back(name);
+    return globals.size() - 1;
+}
+
+uint32_t CodeObject::AddFunction(std::shared_ptr<CodeObject> function) {
+    functions.push_back(std::move(function));
+    return functions.size() - 1;
+}
+
+std::string OpCodeToString(OpCode op){
+    switch (op){
+        case OpCode::CONST: return "CONST";
+        case OpCode::FOLDED: return "FOLDED";
+        case OpCode::LOAD_LOCAL: return "LOAD_LOCAL";
+        case OpCode::DEFINE_LOCAL: return "DEFINE_LOCAL";
+        case OpCode::SET_LOCAL: return "SET_LOCAL";
+        case OpCode::LOAD_GLOBAL: return "LOAD_GLOBAL";
+        case OpCode::DEFINE_GLOBAL: return "DEFINE_GLOBAL";
+        case OpCode::SET_GLOBAL: return "SET_GLOBAL";
+        case OpCode::POP: return "POP";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::JUMP_IF_FALSE_OR_POP: return "JUMP_IF_FALSE_OR_POP";
+        case OpCode::JUMP_IF_TRUE_OR_POP: return "JUMP_IF_TRUE_OR_POP";
+        case OpCode::MAKE_CLOSURE: return "MAKE_CLOSURE";
+        case OpCode::CALL: return "CALL";
+        case OpCode::TAIL_CALL: return "TAIL_CALL";
+        case OpCode::RETURN: return "RETURN";
+        case OpCode::RAISE: return "RAISE";
+    }
+    return "UNKNOWN";
+}
+
+void CodeObject::Trace(Tracer* tracer) {
+    for (auto& value : constants){
+        TraceValue(tracer, value);
+    }
+    for (auto& function : functions){
+        tracer->Visit(function.get());
+    }
+}
+
+void CodeObject::ClearReferences() {
+    constants.clear();
+    functions.clear();
+}
+
+std::string Disassemble(const CodeObject& code){
+    std::string result;
+    for (size_t pc = 0; pc < code.code.size(); ++pc){
+        auto& instruction = code.code[pc];
+        result += IntToString(pc) + " " + OpCodeToString(instruction.op);
+        switch (instruction.op){
+            case OpCode::CONST:
+            case OpCode::FOLDED:
+                result += " " + code.constants[instruction.arg].ToString();
+                break;
+            case OpCode::LOAD_LOCAL:
+            case OpCode::DEFINE_LOCAL:
+            case OpCode::SET_LOCAL:
+                result += " " + IntToString(instruction.depth) + " " +
+                          IntToString(instruction.slot) + " " + code.names[instruction.arg];
+                break;
+            case OpCode::LOAD_GLOBAL:
+            case OpCode::DEFINE_GLOBAL:
+            case OpCode::SET_GLOBAL:
+                result += " " + code.globals[instruction.arg].Name();
+                break;
+            case OpCode::RAISE:
+                result += " " + code.names[instruction.arg];
+                break;
+            case OpCode::POP:
+            case OpCode::RETURN:
+                break;
+            default:
+                result += " " + IntToString(instruction.arg);
+        }
+        result += "\n";
+    }
+    return result;
+}
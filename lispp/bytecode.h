@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "node_types.h"
+
+// local variable instructions address frame slot (depth, slot),
+// arg indexes its name in names for error messages
+enum class OpCode : uint8_t {
+    CONST,                  // push constants[arg]
+    FOLDED,                 // if FoldedExpr constants[arg] holds push its value,
+                            // otherwise skip the JUMP past its original code;
+                            // with a taken branch the JUMP leads to a POP and
+                            // the branch
+    LOAD_LOCAL,             // push value of local slot
+    DEFINE_LOCAL,           // store popped value into local slot, push ()
+    SET_LOCAL,              // assign popped value to bound local slot, push ()
+    LOAD_GLOBAL,            // push value of global globals[arg]
+    DEFINE_GLOBAL,          // bind global globals[arg] to popped value, push ()
+    SET_GLOBAL,             // assign popped value to global globals[arg], push ()
+    POP,
+    JUMP,                   // pc = arg
+    JUMP_IF_FALSE,          // pop, jump if #f
+    JUMP_IF_FALSE_OR_POP,   // jump if top is #f, otherwise pop
+    JUMP_IF_TRUE_OR_POP,    // jump if top is not #f, otherwise pop
+    MAKE_CLOSURE,           // push closure over functions[arg]
+    CALL,                   // call with arg arguments
+    TAIL_CALL,              // call with arg arguments, replacing current frame
+    RETURN,
+    RAISE                   // throw RuntimeError(names[arg])
+};
+
+struct Instruction {
+    OpCode op;
+    uint8_t depth;
+    uint16_t slot;
+    uint32_t arg;
+};
+
+// a heap object like Scope: its constants, such as a quoted list changed by
+// set-cdr!, may refer to the closures made from it
+struct CodeObject : public SharedGcObject<CodeObject> {
+    std::vector<Instruction> code;
+    std::vector<ValueType> constants;
+    std::vector<std::string> names;
+    std::vector<Symbol> globals;
+    std::vector<std::shared_ptr<CodeObject>> functions;
+    size_t arity = 0;
+    size_t frame_size = 0;
+
+    uint32_t Emit(OpCode op, uint32_t arg = 0);
+    uint32_t EmitLocal(OpCode op, const LocalVar& var);
+    uint32_t AddConstant(const ValueType& value);
+    uint32_t AddName(const std::string& name);
+    uint32_t AddGlobal(Symbol name);
+    uint32_t AddFunction(std::shared_ptr<CodeObject> function);
+
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+};
+
+std::string Disassemble(const CodeObject& code);
@@ -0,0 +1,256 @@
+#include "cek.h"
+#include "exceptions.h"
+#include "resolver.h"
+
+#include <algorithm>
+
+namespace {
+// entries of a stack kept after a failed run, larger stacks are freed
+const size_t kKeptStackSize = 1024;
+}
+
+ValueType CekMachine::Run(const NodePtr& node, const std::shared_ptr<Scope>& scope) {
+    size_t depth = frames_.size();
+    size_t values_size = values_.size();
+    State state{node, scope, ValueType()};
+    try {
+        bool has_value = Evaluate(&state);
+        while (true) {
+            if (!has_value){
+                has_value = Evaluate(&state);
+            } else if (frames_.size() == depth){
+                return state.value;
+            } else {
+                has_value = Continue(&state);
+            }
+        }
+    } catch (...) {
+        Unwind(depth, values_size);
+        ReleaseStacks();
+        throw;
+    }
+}
+
+size_t CekMachine::MaxDepth() const {
+    return max_depth_;
+}
+
+size_t CekMachine::MaxValues() const {
+    return max_values_;
+}
+
+size_t CekMachine::MaxStackBytes() const {
+    return max_depth_ * sizeof(Frame) + max_values_ * sizeof(ValueType);
+}
+
+void CekMachine::TraceRoots(Tracer* tracer) const {
+    for (auto& frame : frames_){
+        TraceNode(tracer, frame.node);
+        TraceScope(tracer, frame.scope);
+    }
+    for (auto& value : values_){
+        TraceValue(tracer, value);
+    }
+}
+
+void CekMachine::Push(FrameType type, NodePtr node, std::shared_ptr<Scope> scope, size_t base) {
+    frames_.push_back({type, std::move(node), std::move(scope), 0, base});
+    max_depth_ = std::max(max_depth_, frames_.size());
+}
+
+bool CekMachine::Evaluate(State* state) {
+    auto node = state->control.get();
+    switch (node->Type()){
+        case NodeType::FOLDED: {
+            auto folded = static_cast<FoldedExpr*>(node);
+            if (folded->Holds(state->env.get())){
+                if (folded->Taken()){
+                    state->control = folded->Taken();
+                    return false;
+                }
+                state->value = folded->Value();
+                return true;
+            }
+            state->control = folded->Original();
+            return false;
+        }
+        case NodeType::IF:
+            Push(FrameType::IF, state->control, state->env);
+            state->control = static_cast<IfExpr*>(node)->Test();
+            return false;
+        case NodeType::DEFINE:
+        case NodeType::SET:
+            Push(FrameType::ASSIGN, state->control, state->env);
+            state->control = static_cast<AssignExpr*>(node)->Value();
+            return false;
+        case NodeType::AND:
+        case NodeType::OR: {
+            auto& args = static_cast<LogicExpr*>(node)->Args();
+            if (args.empty()){
+                state->value = ValueType(node->Type() == NodeType::AND);
+                return true;
+            }
+            if (args.size() > 1){
+                Push(FrameType::LOGIC, state->control, state->env);
+            }
+            state->control = args.front();
+            return false;
+        }
+        case NodeType::CALL:
+            Push(FrameType::CALL, state->control, state->env, values_.size());
+            state->control = static_cast<CallExpr*>(node)->Function();
+            return false;
+        default:
+            // constants, variables and lambda expressions do not recurse
+            state->value = node->ComputeValue(state->env);
+            return true;
+    }
+}
+
+bool CekMachine::Continue(State* state) {
+    auto& frame = frames_.back();
+    switch (frame.type){
+        case FrameType::IF: {
+            auto if_expr = static_cast<IfExpr*>(frame.node.get());
+            auto& branch = IsTrue(state->value) ? if_expr->Consequent() : if_expr->Alternative();
+            if (!branch){
+                frames_.pop_back();
+                state->value = ValueType(NodePtr(new Empty()));
+                return true;
+            }
+            state->control = branch;
+            state->env = std::move(frame.scope);
+            frames_.pop_back();
+            return false;
+        }
+        case FrameType::ASSIGN: {
+            auto assign = static_cast<AssignExpr*>(frame.node.get());
+            auto& target = assign->Target();
+            bool is_define = assign->Type() == NodeType::DEFINE;
+            if (target->Type() == NodeType::LOCAL_VAR){
+                auto var = static_cast<LocalVar*>(target.get());
+                if (is_define){
+                    var->Define(frame.scope, state->value);
+                } else {
+                    var->SetValue(frame.scope, state->value);
+                }
+            } else {
+                auto name = static_cast<Var*>(target.get())->GetSymbol();
+                if (is_define){
+                    frame.scope->AddName(name, state->value);
+                } else {
+                    frame.scope->SetValue(name, state->value);
+                }
+            }
+            frames_.pop_back();
+            state->value = ValueType(NodePtr(new Empty()));
+            return true;
+        }
+        case FrameType::LOGIC: {
+            auto logic = static_cast<LogicExpr*>(frame.node.get());
+            if (IsTrue(state->value) != (logic->Type() == NodeType::AND)){
+                frames_.pop_back();
+                return true;
+            }
+            auto& args = logic->Args();
+            state->control = args[++frame.index];
+            state->env = frame.scope;
+            if (frame.index + 1 == args.size()){
+                frames_.pop_back();
+            }
+            return false;
+        }
+        case FrameType::CALL: {
+            auto& args = static_cast<CallExpr*>(frame.node.get())->Args();
+            values_.push_back(std::move(state->value));
+            max_values_ = std::max(max_values_, values_.size());
+            size_t computed = values_.size() - frame.base;
+            if (computed <= args.size()){
+                state->control = args[computed - 1];
+                state->env = frame.scope;
+                return false;
+            }
+            auto base = frame.base;
+            auto scope = std::move(frame.scope);
+            auto node = std::move(frame.node);
+            frames_.pop_back();
+            return Apply(base, scope, state);
+        }
+        case FrameType::BODY: {
+            auto& body = static_cast<FuncList*>(frame.node.get())->Elements();
+            state->control = body[++frame.index];
+            state->env = frame.scope;
+            if (frame.index + 1 == body.size()){
+                frames_.pop_back();
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CekMachine::Apply(size_t base, const std::shared_ptr<Scope>& scope, State* state) {
+    GcSafepoint();
+    auto function = std::move(values_[base]);
+    ArgSpan args(values_.data() + base + 1, values_.size() - base - 1);
+    if (function.GetType() != ValueType::ValueEnum::FUNC){
+        throw RuntimeError(function.ToString() + " is not self evaluating");
+    }
+    auto node = function.AsNode();
+    // a VM Closure is a LAMBDA too
+    auto lambda = node->Type() == NodeType::LAMBDA ? dynamic_cast<Lambda*>(node) : nullptr;
+    if (lambda){
+        if (args.size() != lambda->arity_){
+            throw RuntimeError("wrong number of arguments in function call");
+        }
+        ++lambda->call_count_;
+        if (scope->Owner() == lambda){
+            ++lambda->back_edge_count_;
+        }
+        auto frame = MakeScope(lambda->inner_scope_, lambda->frame_size_, lambda);
+        auto slots = frame->Slots();
+        for (size_t i = 0; i < args.size(); ++i){
+            slots[i] = std::move(values_[base + 1 + i]);
+        }
+        values_.resize(base);
+        auto& body = static_cast<FuncList*>(lambda->func_.get())->Elements();
+        if (body.size() > 1){
+            Push(FrameType::BODY, lambda->func_, frame);
+        }
+        state->control = body.front();
+        state->env = std::move(frame);
+        return false;
+    }
+    auto func = node->AsFunc();
+    if (!func){
+        throw RuntimeError(node->ToString() + " is not self evaluating");
+    }
+    // eval continues in the machine instead of recursing into the tree walker
+    if (args.size() == 1 && args[0].GetType() == ValueType::ValueEnum::FUNC &&
+            dynamic_cast<Eval*>(func)){
+        state->control = Resolver().Resolve(args[0].GetValue<NodePtr>());
+        state->env = GlobalScope(scope);
+        values_.resize(base);
+        return false;
+    }
+    state->value = func->Call(args, scope, nullptr);
+    values_.resize(base);
+    return true;
+}
+
+void CekMachine::Unwind(size_t depth, size_t values_size) {
+    frames_.erase(frames_.begin() + depth, frames_.end());
+    values_.resize(values_size);
+}
+
+void CekMachine::ReleaseStacks() {
+    if (!frames_.empty() || !values_.empty()){
+        return;
+    }
+    if (frames_.capacity() > kKeptStackSize){
+        frames_.shrink_to_fit();
+    }
+    if (values_.capacity() > kKeptStackSize){
+        values_.shrink_to_fit();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "node_types.h"
+
+// Evaluator for expressions rewritten by Resolver which keeps its control
+// stack on the heap: a CEK machine whose control is the expression being
+// evaluated, whose environment is the frame it is evaluated in and whose
+// continuation is the stack of frames waiting for its value. Calls of
+// Lambda push no native frames, so the depth of non-tail recursion is
+// bounded only by memory; expressions in tail position push no
+// continuation frames.
+class CekMachine{
+public:
+    ValueType Run(const NodePtr& node, const std::shared_ptr<Scope>& scope);
+    // largest number of continuation frames and of pending argument values
+    // held at once since the machine was created
+    size_t MaxDepth() const;
+    size_t MaxValues() const;
+    // bytes of the continuation and argument stacks at their largest
+    size_t MaxStackBytes() const;
+    // continuation frames and pending values, roots of the collector
+    void TraceRoots(Tracer* tracer) const;
+
+private:
+    enum class FrameType {
+        IF, ASSIGN, LOGIC, CALL, BODY
+    };
+
+    // node is waiting for the value of its element index; a CALL keeps the
+    // values computed so far on values_ starting from base
+    struct Frame {
+        FrameType type;
+        NodePtr node;
+        std::shared_ptr<Scope> scope;
+        size_t index;
+        size_t base;
+    };
+
+    // an expression to evaluate in env, or its value once it is computed
+    struct State {
+        NodePtr control;
+        std::shared_ptr<Scope> env;
+        ValueType value;
+    };
+
+    // count against the memory limit, so deep recursion is bounded by it
+    GcVector<Frame> frames_;
+    GcVector<ValueType> values_;
+    size_t max_depth_ = 0;
+    size_t max_values_ = 0;
+
+    void Push(FrameType type, NodePtr node, std::shared_ptr<Scope> scope, size_t base = 0);
+    // each returns true if it computed state->value, false if it set a new
+    // control to evaluate
+    bool Evaluate(State* state);
+    bool Continue(State* state);
+    bool Apply(size_t base, const std::shared_ptr<Scope>& scope, State* state);
+    void Unwind(size_t depth, size_t values_size);
+    // frees the stacks grown by deep recursion once the outermost run fails,
+    // which may have stopped at the memory limit
+    void ReleaseStacks();
+};
@@ -0,0 +1,458 @@
+#include "closure_compiler.h"
+#include "exceptions.h"
+
+#include <array>
+
+void ClosureBody::Trace(Tracer* tracer) {
+    for (auto& value : constants){
+        TraceValue(tracer, value);
+    }
+    for (auto& function : functions){
+        tracer->Visit(function.get());
+    }
+}
+
+void ClosureBody::ClearReferences() {
+    constants.clear();
+    functions.clear();
+}
+
+CompiledClosure::CompiledClosure(size_t arity, size_t frame_size,
+                                 std::shared_ptr<ClosureBody> body,
+                                 std::shared_ptr<Scope> scope) :
+        arity_(arity), frame_size_(frame_size), body_(std::move(body)),
+        scope_(std::move(scope)) {}
+
+std::shared_ptr<Scope> CompiledClosure::BindFrame(ArgSpan args) {
+    if (args.size() != arity_){
+        throw RuntimeError("wrong number of arguments in function call");
+    }
+    ++call_count_;
+    auto frame = MakeScope(scope_, frame_size_, this);
+    auto slots = frame->Slots();
+    for (size_t i = 0; i < args.size(); ++i){
+        slots[i] = args[i];
+    }
+    return frame;
+}
+
+ValueType CompiledClosure::Apply(ArgSpan args) {
+    // the body may rebind the name the closure was called by
+    Ref<CompiledClosure> closure(this);
+    auto frame = BindFrame(args);
+    while (true) {
+        GcSafepoint();
+        ClosureTail tail;
+        auto value = closure->body_->code(frame, &tail);
+        if (!tail.closure){
+            return value;
+        }
+        closure = std::move(tail.closure);
+        frame = std::move(tail.frame);
+    }
+}
+
+ValueType CompiledClosure::Call(ArgSpan args, const std::shared_ptr<Scope>& scope,
+                                ClosureTail* tail) {
+    if (scope && scope->Owner() == this){
+        ++back_edge_count_;
+    }
+    if (!tail){
+        return Apply(args);
+    }
+    tail->frame = BindFrame(args);
+    tail->closure = Ref<CompiledClosure>(this);
+    return ValueType();
+}
+
+bool CompiledClosure::IsClosure() const {
+    return true;
+}
+
+size_t CompiledClosure::CallCount() const {
+    return call_count_;
+}
+
+size_t CompiledClosure::BackEdgeCount() const {
+    return back_edge_count_;
+}
+
+void CompiledClosure::Trace(Tracer* tracer) {
+    tracer->Visit(body_.get());
+    TraceScope(tracer, scope_);
+}
+
+void CompiledClosure::ClearReferences() {
+    body_.reset();
+    scope_.reset();
+}
+
+namespace {
+
+Func* AsCallable(const ValueType& function) {
+    if (function.GetType() != ValueType::ValueEnum::FUNC){
+        throw RuntimeError(function.ToString() + " is not self evaluating");
+    }
+    auto func = function.AsNode()->AsFunc();
+    if (!func){
+        throw RuntimeError(function.AsNode()->ToString() + " is not self evaluating");
+    }
+    return func;
+}
+
+// head of a call; a function bound to a global name is cached together
+// with the global binding version and its FixnumOp
+class Callee{
+public:
+    Callee(Scope* global_scope, Symbol name) :
+            global_scope_(global_scope), name_(name), is_global_(true) {}
+
+    explicit Callee(ClosureCode code) : code_(std::move(code)) {}
+
+    // function keeps the returned function alive until the call is done,
+    // the arguments evaluated meanwhile may rebind its global name
+    Func* Get(const std::shared_ptr<Scope>& scope, ValueType* function) {
+        if (!is_global_){
+            *function = code_(scope, nullptr);
+            return AsCallable(*function);
+        }
+        if (version_ != Scope::BindingVersion()){
+            *function = global_scope_->GetValue(name_);
+            func_ = AsCallable(*function);
+            op_ = FixnumOpOf(func_);
+            version_ = Scope::BindingVersion();
+        } else {
+            *function = ValueType(NodePtr(func_));
+        }
+        return func_;
+    }
+
+    // FixnumOp of the function the last Get returned
+    FixnumOp Op() const {
+        return op_;
+    }
+
+private:
+    Scope* global_scope_ = nullptr;
+    Symbol name_;
+    bool is_global_ = false;
+    ClosureCode code_;
+    uint64_t version_ = 0;
+    Func* func_ = nullptr;
+    FixnumOp op_ = FixnumOp::NONE;
+};
+
+template <size_t N, bool Tail>
+ClosureCode MakeCall(Callee callee, const std::vector<ClosureCode>& args) {
+    std::array<ClosureCode, N> codes;
+    std::copy(args.begin(), args.end(), codes.begin());
+    return [callee, codes](const std::shared_ptr<Scope>& scope,
+                           ClosureTail* tail) mutable {
+        ValueType function;
+        auto func = callee.Get(scope, &function);
+        std::array<ValueType, N> values;
+        for (size_t i = 0; i < N; ++i){
+            values[i] = codes[i](scope, nullptr);
+        }
+        return func->Call(ArgSpan(values.data(), N), scope, Tail ? tail : nullptr);
+    };
+}
+
+// call of a global function with two arguments, specialized on the type
+// feedback of the site like CallExpr
+template <bool Tail>
+ClosureCode MakeBinaryCall(Callee callee, ClosureCode lhs, ClosureCode rhs) {
+    auto feedback = TypeFeedback::UNSEEN;
+    return [callee, lhs, rhs, feedback](const std::shared_ptr<Scope>& scope,
+                                        ClosureTail* tail) mutable {
+        ValueType function;
+        auto func = callee.Get(scope, &function);
+        ValueType values[] = {lhs(scope, nullptr), rhs(scope, nullptr)};
+        if (callee.Op() != FixnumOp::NONE && feedback != TypeFeedback::GENERIC){
+            ValueType result;
+            if (ApplyFixnumOp(callee.Op(), values[0], values[1], &result)){
+                feedback = TypeFeedback::FIXNUM;
+                return result;
+            }
+            feedback = TypeFeedback::GENERIC;
+        }
+        return func->Call(ArgSpan(values, 2), scope, Tail ? tail : nullptr);
+    };
+}
+
+template <bool Tail>
+ClosureCode MakeCall(Callee callee, std::vector<ClosureCode> args) {
+    switch (args.size()){
+        case 0:
+            return MakeCall<0, Tail>(std::move(callee), args);
+        case 1:
+            return MakeCall<1, Tail>(std::move(callee), args);
+        case 2:
+            return MakeCall<2, Tail>(std::move(callee), args);
+        case 3:
+            return MakeCall<3, Tail>(std::move(callee), args);
+        default:
+            break;
+    }
+    return [callee, args](const std::shared_ptr<Scope>& scope,
+                          ClosureTail* tail) mutable {
+        ValueType function;
+        auto func = callee.Get(scope, &function);
+        std::vector<ValueType> values;
+        values.reserve(args.size());
+        for (auto& arg : args){
+            values.push_back(arg(scope, nullptr));
+        }
+        return func->Call(ArgSpan(values.data(), values.size()), scope,
+                          Tail ? tail : nullptr);
+    };
+}
+
+ValueType EmptyValue() {
+    return ValueType(NodePtr(new Empty()));
+}
+
+}  // namespace
+
+ClosureCompiler::ClosureCompiler(std::shared_ptr<Scope> global_scope) :
+        global_scope_(std::move(global_scope)) {}
+
+ClosureCode ClosureCompiler::Compile(const NodePtr& node) {
+    auto body = MakeShared<ClosureBody>();
+    body_ = body.get();
+    body->code = Compile(node, false);
+    body_ = nullptr;
+    return [body](const std::shared_ptr<Scope>& scope, ClosureTail* tail) {
+        return body->code(scope, tail);
+    };
+}
+
+const ValueType* ClosureCompiler::Borrow(ValueType value) {
+    body_->constants.push_back(std::move(value));
+    return &body_->constants.back();
+}
+
+template <class T>
+T* ClosureCompiler::BorrowNode(const NodePtr& node) {
+    body_->constants.emplace_back(node);
+    return static_cast<T*>(node.get());
+}
+
+ClosureCode ClosureCompiler::Compile(const NodePtr& node, bool tail) {
+    switch (node->Type()){
+        case NodeType::CONST:
+        case NodeType::QUOTE: {
+            auto value = Borrow(node->ComputeValue(nullptr));
+            return [value](const std::shared_ptr<Scope>&, ClosureTail*) {
+                return *value;
+            };
+        }
+        case NodeType::VAR: {
+            auto global_scope = global_scope_.get();
+            auto name = static_cast<Var*>(node.get())->GetSymbol();
+            return [global_scope, name](const std::shared_ptr<Scope>&, ClosureTail*) {
+                return global_scope->GetValue(name);
+            };
+        }
+        case NodeType::LOCAL_VAR:
+            return CompileLocal(*static_cast<LocalVar*>(node.get()));
+        case NodeType::LAMBDA_EXPR:
+            return CompileLambda(*static_cast<LambdaExpr*>(node.get()));
+        case NodeType::EMPTY:
+            return [](const std::shared_ptr<Scope>&, ClosureTail*) -> ValueType {
+                throw RuntimeError("() is not self evaluating");
+            };
+        case NodeType::FOLDED: {
+            auto global_scope = global_scope_.get();
+            auto folded = BorrowNode<FoldedExpr>(node);
+            auto original = Compile(folded->Original(), tail);
+            if (folded->Taken()){
+                auto taken = Compile(folded->Taken(), tail);
+                return [global_scope, folded, taken, original](
+                        const std::shared_ptr<Scope>& scope, ClosureTail* tail) {
+                    if (folded->Holds(global_scope)){
+                        return taken(scope, tail);
+                    }
+                    return original(scope, tail);
+                };
+            }
+            return [global_scope, folded, original](const std::shared_ptr<Scope>& scope,
+                                                    ClosureTail* tail) {
+                if (folded->Holds(global_scope)){
+                    return folded->Value();
+                }
+                return original(scope, tail);
+            };
+        }
+        case NodeType::IF:
+            return CompileIf(*static_cast<IfExpr*>(node.get()), tail);
+        case NodeType::DEFINE:
+        case NodeType::SET:
+            return CompileAssign(*static_cast<AssignExpr*>(node.get()));
+        case NodeType::AND:
+        case NodeType::OR:
+            return CompileLogic(*static_cast<LogicExpr*>(node.get()), tail);
+        case NodeType::CALL:
+            return CompileCall(*static_cast<CallExpr*>(node.get()), tail);
+        default: {
+            auto raw = BorrowNode<ASTNode>(node);
+            return [raw](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+                return raw->ComputeValue(scope);
+            };
+        }
+    }
+}
+
+ClosureCode ClosureCompiler::CompileLocal(const LocalVar& var) {
+    auto name = var.ToString();
+    auto depth = var.Depth();
+    auto index = var.Index();
+    if (depth == 0){
+        return [name, index](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+            auto& value = scope->Slots()[index];
+            if (value.GetType() == ValueType::ValueEnum::UNDEFINED){
+                throw NameError("undefined name " + name);
+            }
+            return value;
+        };
+    }
+    return [name, depth, index](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+        auto& value = scope->Slot(depth, index);
+        if (value.GetType() == ValueType::ValueEnum::UNDEFINED){
+            throw NameError("undefined name " + name);
+        }
+        return value;
+    };
+}
+
+ClosureCode ClosureCompiler::CompileLambda(const LambdaExpr& lambda) {
+    auto parent = body_;
+    auto function = MakeShared<ClosureBody>();
+    body_ = function.get();
+    auto& elements = lambda.Body().Elements();
+    std::vector<ClosureCode> body;
+    for (size_t i = 0; i < elements.size(); ++i){
+        body.push_back(Compile(elements[i], i + 1 == elements.size()));
+    }
+    if (body.size() == 1){
+        function->code = std::move(body.front());
+    } else {
+        function->code = [body](const std::shared_ptr<Scope>& scope, ClosureTail* tail) {
+            if (body.empty()){
+                return EmptyValue();
+            }
+            for (size_t i = 0; i + 1 < body.size(); ++i){
+                body[i](scope, nullptr);
+            }
+            return body.back()(scope, tail);
+        };
+    }
+    body_ = parent;
+    // the enclosing body owns the function, closures share it
+    auto index = parent->functions.size();
+    parent->functions.push_back(std::move(function));
+    auto arity = lambda.Arity();
+    auto frame_size = lambda.FrameSize();
+    return [arity, frame_size, parent, index](const std::shared_ptr<Scope>& scope,
+                                              ClosureTail*) {
+        return ValueType(NodePtr(new CompiledClosure(arity, frame_size,
+                                                     parent->functions[index], scope)));
+    };
+}
+
+ClosureCode ClosureCompiler::CompileIf(const IfExpr& if_expr, bool tail) {
+    auto test = Compile(if_expr.Test(), false);
+    auto consequent = Compile(if_expr.Consequent(), tail);
+    if (!if_expr.Alternative()){
+        return [test, consequent](const std::shared_ptr<Scope>& scope, ClosureTail* tail) {
+            if (IsTrue(test(scope, nullptr))){
+                return consequent(scope, tail);
+            }
+            return EmptyValue();
+        };
+    }
+    auto alternative = Compile(if_expr.Alternative(), tail);
+    return [test, consequent, alternative](const std::shared_ptr<Scope>& scope,
+                                           ClosureTail* tail) {
+        if (IsTrue(test(scope, nullptr))){
+            return consequent(scope, tail);
+        }
+        return alternative(scope, tail);
+    };
+}
+
+ClosureCode ClosureCompiler::CompileAssign(const AssignExpr& assign) {
+    auto value = Compile(assign.Value(), false);
+    bool is_define = assign.Type() == NodeType::DEFINE;
+    auto& target = assign.Target();
+    if (target->Type() == NodeType::LOCAL_VAR){
+        auto var = BorrowNode<LocalVar>(target);
+        if (is_define){
+            return [value, var](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+                var->Define(scope, value(scope, nullptr));
+                return EmptyValue();
+            };
+        }
+        return [value, var](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+            var->SetValue(scope, value(scope, nullptr));
+            return EmptyValue();
+        };
+    }
+    auto global_scope = global_scope_.get();
+    auto name = static_cast<Var*>(target.get())->GetSymbol();
+    if (is_define){
+        return [value, global_scope, name](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+            global_scope->AddName(name, value(scope, nullptr));
+            return EmptyValue();
+        };
+    }
+    return [value, global_scope, name](const std::shared_ptr<Scope>& scope, ClosureTail*) {
+        global_scope->SetValue(name, value(scope, nullptr));
+        return EmptyValue();
+    };
+}
+
+ClosureCode ClosureCompiler::CompileLogic(const LogicExpr& logic, bool tail) {
+    bool is_and = logic.Type() == NodeType::AND;
+    auto& args = logic.Args();
+    if (args.empty()){
+        return [is_and](const std::shared_ptr<Scope>&, ClosureTail*) {
+            return ValueType(is_and);
+        };
+    }
+    std::vector<ClosureCode> codes;
+    for (size_t i = 0; i < args.size(); ++i){
+        codes.push_back(Compile(args[i], tail && i + 1 == args.size()));
+    }
+    return [is_and, codes](const std::shared_ptr<Scope>& scope, ClosureTail* tail) {
+        for (size_t i = 0; i + 1 < codes.size(); ++i){
+            auto value = codes[i](scope, nullptr);
+            if (IsTrue(value) != is_and){
+                return value;
+            }
+        }
+        return codes.back()(scope, tail);
+    };
+}
+
+ClosureCode ClosureCompiler::CompileCall(const CallExpr& call, bool tail) {
+    auto& function = call.Function();
+    bool is_global = function->Type() == NodeType::VAR;
+    Callee callee = is_global ?
+                    Callee(global_scope_.get(), static_cast<Var*>(function.get())->GetSymbol()) :
+                    Callee(Compile(function, false));
+    std::vector<ClosureCode> args;
+    for (auto& arg : call.Args()){
+        args.push_back(Compile(arg, false));
+    }
+    if (is_global && args.size() == 2){
+        if (tail){
+            return MakeBinaryCall<true>(std::move(callee), args[0], args[1]);
+        }
+        return MakeBinaryCall<false>(std::move(callee), args[0], args[1]);
+    }
+    if (tail){
+        return MakeCall<true>(std::move(callee), std::move(args));
+    }
+    return MakeCall<false>(std::move(callee), std::move(args));
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "node_types.h"
+
+// Closure compilation: every expression rewritten by Resolver is turned
+// once into a C++ callable computing its value. Slots, global names,
+// callees and argument counts are bound while compiling, so running the
+// code does not look at node types. A call of a compiled lambda in tail
+// position binds the callee's frame into ClosureTail, and the caller runs
+// the callee's body in a loop, so tail calls do not grow the native stack.
+
+class CompiledClosure;
+
+struct ClosureTail {
+    Ref<CompiledClosure> closure;
+    std::shared_ptr<Scope> frame;
+};
+
+using ClosureCode = std::function<ValueType(const std::shared_ptr<Scope>& scope,
+                                            ClosureTail* tail)>;
+
+// code of a lambda with what it refers to: the callables only borrow its
+// constants, nodes and nested lambdas, and the body reports them to the
+// collector, since a quoted list changed by set-cdr! may refer to the
+// closures made from it
+class ClosureBody : public SharedGcObject<ClosureBody>{
+public:
+    ClosureCode code;
+    // a deque keeps the borrowed addresses stable
+    std::deque<ValueType> constants;
+    std::vector<std::shared_ptr<ClosureBody>> functions;
+
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+};
+
+class CompiledClosure : public Primitive{
+public:
+    CompiledClosure(size_t arity, size_t frame_size, std::shared_ptr<ClosureBody> body,
+                    std::shared_ptr<Scope> scope);
+    ValueType Apply(ArgSpan args) override;
+    ValueType Call(ArgSpan args, const std::shared_ptr<Scope>& scope,
+                   ClosureTail* tail) override;
+    bool IsClosure() const override;
+    size_t CallCount() const override;
+    size_t BackEdgeCount() const override;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    size_t arity_;
+    size_t frame_size_;
+    std::shared_ptr<ClosureBody> body_;
+    std::shared_ptr<Scope> scope_;
+    size_t call_count_ = 0;
+    size_t back_edge_count_ = 0;
+
+    std::shared_ptr<Scope> BindFrame(ArgSpan args);
+};
+
+class ClosureCompiler{
+public:
+    explicit ClosureCompiler(std::shared_ptr<Scope> global_scope);
+    // code of a top-level expression, run it with the global scope and a
+    // null tail
+    ClosureCode Compile(const NodePtr& node);
+
+private:
+    std::shared_ptr<Scope> global_scope_;
+    // body of the lambda being compiled
+    ClosureBody* body_ = nullptr;
+
+    ClosureCode Compile(const NodePtr& node, bool tail);
+    const ValueType* Borrow(ValueType value);
+    template <class T>
+    T* BorrowNode(const NodePtr& node);
+    ClosureCode CompileLocal(const LocalVar& var);
+    ClosureCode CompileLambda(const LambdaExpr& lambda);
+    ClosureCode CompileIf(const IfExpr& if_expr, bool tail);
+    ClosureCode CompileAssign(const AssignExpr& assign);
+    ClosureCode CompileLogic(const LogicExpr& logic, bool tail);
+    ClosureCode CompileCall(const CallExpr& call, bool tail);
+};
@@ -0,0 +1,141 @@
+#include "compiler.h"
+#include "exceptions.h"
+
+std::shared_ptr<CodeObject> Compiler::Compile(const NodePtr& node) {
+    auto code = MakeShared<CodeObject>();
+    CompileExpression(code.get(), node, true);
+    code->Emit(OpCode::RETURN);
+    return code;
+}
+
+void Compiler::CompileExpression(CodeObject* code, const NodePtr& node, bool tail) {
+    switch (node->Type()){
+        case NodeType::CONST:
+        case NodeType::QUOTE:
+            code->Emit(OpCode::CONST, code->AddConstant(node->ComputeValue(nullptr)));
+            return;
+        case NodeType::VAR:
+            code->Emit(OpCode::LOAD_GLOBAL,
+                       code->AddGlobal(static_cast<Var*>(node.get())->GetSymbol()));
+            return;
+        case NodeType::LOCAL_VAR:
+            code->EmitLocal(OpCode::LOAD_LOCAL, *dynamic_cast<LocalVar*>(node.get()));
+            return;
+        case NodeType::LAMBDA_EXPR:
+            code->Emit(OpCode::MAKE_CLOSURE, code->AddFunction(
+                    CompileFunction(*dynamic_cast<LambdaExpr*>(node.get()))));
+            return;
+        case NodeType::EMPTY:
+            code->Emit(OpCode::RAISE, code->AddName("() is not self evaluating"));
+            return;
+        case NodeType::FOLDED:
+            CompileFolded(code, node, tail);
+            return;
+        case NodeType::IF:
+            CompileIf(code, *static_cast<IfExpr*>(node.get()), tail);
+            return;
+        case NodeType::DEFINE:
+        case NodeType::SET:
+            CompileAssign(code, *static_cast<AssignExpr*>(node.get()),
+                          node->Type() == NodeType::DEFINE);
+            return;
+        case NodeType::AND:
+        case NodeType::OR:
+            CompileLogic(code, static_cast<LogicExpr*>(node.get())->Args(), tail,
+                         node->Type() == NodeType::AND);
+            return;
+        case NodeType::CALL:
+            CompileCall(code, *static_cast<CallExpr*>(node.get()), tail);
+            return;
+        default:
+            code->Emit(OpCode::CONST, code->AddConstant(ValueType(node)));
+            return;
+    }
+}
+
+void Compiler::CompileBody(CodeObject* code, const std::vector<NodePtr>& body) {
+    for (size_t i = 0; i + 1 < body.size(); ++i){
+        CompileExpression(code, body[i], false);
+        code->Emit(OpCode::POP);
+    }
+    CompileExpression(code, body.back(), true);
+    code->Emit(OpCode::RETURN);
+}
+
+void Compiler::CompileCall(CodeObject* code, const CallExpr& node, bool tail) {
+    auto& args = node.Args();
+    CompileExpression(code, node.Function(), false);
+    for (auto& arg : args){
+        CompileExpression(code, arg, false);
+    }
+    code->Emit(tail ? OpCode::TAIL_CALL : OpCode::CALL, args.size());
+}
+
+void Compiler::CompileFolded(CodeObject* code, const NodePtr& node, bool tail) {
+    auto folded = static_cast<FoldedExpr*>(node.get());
+    code->Emit(OpCode::FOLDED, code->AddConstant(ValueType(node)));
+    auto to_end = code->Emit(OpCode::JUMP);
+    CompileExpression(code, folded->Original(), tail);
+    if (folded->Taken()){
+        // the jump taken while the guards hold leads past the original code
+        // to the taken branch, which replaces the pushed value
+        auto to_taken = to_end;
+        to_end = code->Emit(OpCode::JUMP);
+        code->code[to_taken].arg = code->code.size();
+        code->Emit(OpCode::POP);
+        CompileExpression(code, folded->Taken(), tail);
+    }
+    code->code[to_end].arg = code->code.size();
+}
+
+void Compiler::CompileIf(CodeObject* code, const IfExpr& node, bool tail) {
+    CompileExpression(code, node.Test(), false);
+    auto to_else = code->Emit(OpCode::JUMP_IF_FALSE);
+    CompileExpression(code, node.Consequent(), tail);
+    auto to_end = code->Emit(OpCode::JUMP);
+    code->code[to_else].arg = code->code.size();
+    if (node.Alternative()){
+        CompileExpression(code, node.Alternative(), tail);
+    } else {
+        code->Emit(OpCode::CONST, code->AddConstant(ValueType(NodePtr(new Empty()))));
+    }
+    code->code[to_end].arg = code->code.size();
+}
+
+void Compiler::CompileAssign(CodeObject* code, const AssignExpr& node, bool is_define) {
+    CompileExpression(code, node.Value(), false);
+    auto& target = node.Target();
+    if (target->Type() == NodeType::LOCAL_VAR){
+        code->EmitLocal(is_define ? OpCode::DEFINE_LOCAL : OpCode::SET_LOCAL,
+                        *static_cast<LocalVar*>(target.get()));
+    } else {
+        code->Emit(is_define ? OpCode::DEFINE_GLOBAL : OpCode::SET_GLOBAL,
+                   code->AddGlobal(static_cast<Var*>(target.get())->GetSymbol()));
+    }
+}
+
+void Compiler::CompileLogic(CodeObject* code, const std::vector<NodePtr>& args,
+                            bool tail, bool is_and) {
+    if (args.empty()){
+        code->Emit(OpCode::CONST, code->AddConstant(ValueType(is_and)));
+        return;
+    }
+    std::vector<uint32_t> exits;
+    for (size_t i = 0; i + 1 < args.size(); ++i){
+        CompileExpression(code, args[i], false);
+        exits.push_back(code->Emit(is_and ? OpCode::JUMP_IF_FALSE_OR_POP :
+                                            OpCode::JUMP_IF_TRUE_OR_POP));
+    }
+    CompileExpression(code, args.back(), tail);
+    for (auto exit : exits){
+        code->code[exit].arg = code->code.size();
+    }
+}
+
+std::shared_ptr<CodeObject> Compiler::CompileFunction(const LambdaExpr& lambda) {
+    auto function = MakeShared<CodeObject>();
+    function->arity = lambda.Arity();
+    function->frame_size = lambda.FrameSize();
+    CompileBody(function.get(), lambda.Body().Elements());
+    return function;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "bytecode.h"
+
+// Compiles an expression already rewritten by Resolver.
+class Compiler{
+public:
+    std::shared_ptr<CodeObject> Compile(const NodePtr& node);
+
+private:
+    void CompileExpression(CodeObject* code, const NodePtr& node, bool tail);
+    void CompileBody(CodeObject* code, const std::vector<NodePtr>& body);
+    void CompileCall(CodeObject* code, const CallExpr& node, bool tail);
+    void CompileFolded(CodeObject* code, const NodePtr& node, bool tail);
+    void CompileIf(CodeObject* code, const IfExpr& node, bool tail);
+    void CompileAssign(CodeObject* code, const AssignExpr& node, bool is_define);
+    void CompileLogic(CodeObject* code, const std::vector<NodePtr>& args,
+                      bool tail, bool is_and);
+    std::shared_ptr<CodeObject> CompileFunction(const LambdaExpr& lambda);
+};
@@ -0,0 +1,183 @@
+#include "cpp_emitter.h"
+#include "common_functions.h"
+#include "exceptions.h"
+#include "parser.h"
+#include "resolver.h"
+
+std::string CppString(const std::string& text){
+    std::string result = "\"";
+    for (auto c : text){
+        if (c == '"' || c == '\\'){
+            result += '\\';
+        }
+        result += c;
+    }
+    return result + "\"";
+}
+
+void CppEmitter::AddForm(const NodePtr& node) {
+    forms_ += "    AotRunForm(out, [&] { return " + Expression(node, false) + "; });\n";
+}
+
+std::string CppEmitter::Source() const {
+    std::string result = "// generated by lispp --compile\n"
+                         "#include <lispp/aot.h>\n\n"
+                         "namespace {\n\n";
+    for (size_t i = 0; i < symbols_.size(); ++i){
+        result += "const Symbol symbol_" + IntToString(i) + " = Symbol::Intern(" +
+                  CppString(symbols_[i].Name()) + ");\n";
+    }
+    for (size_t i = 0; i < constants_.size(); ++i){
+        result += "const ValueType constant_" + IntToString(i) + " = " + constants_[i] + ";\n";
+    }
+    result += "\n" + functions_ + "}  // namespace\n\n"
+              "void CompiledProgram(const std::shared_ptr<Scope>& scope, std::ostream* out) {\n" +
+              forms_ + "}\n\n"
+              "#ifndef LISPP_AOT_NO_MAIN\n"
+              "int main() {\n"
+              "    return RunCompiledProgram();\n"
+              "}\n"
+              "#endif\n";
+    return result;
+}
+
+std::string CppEmitter::Expression(const NodePtr& node, bool tail) {
+    switch (node->Type()){
+        case NodeType::CONST:
+        case NodeType::QUOTE:
+            return Constant(node->ComputeValue(nullptr));
+        case NodeType::VAR:
+            return "AotGlobal(scope, " +
+                   SymbolRef(static_cast<Var*>(node.get())->GetSymbol()) + ")";
+        case NodeType::LOCAL_VAR: {
+            auto var = static_cast<LocalVar*>(node.get());
+            return "AotLocal(scope, " + IntToString(var->Depth()) + ", " +
+                   IntToString(var->Index()) + ", " + CppString(var->ToString()) + ")";
+        }
+        case NodeType::LAMBDA_EXPR:
+            return Lambda(*static_cast<LambdaExpr*>(node.get()));
+        case NodeType::EMPTY:
+            return "AotRaise(\"() is not self evaluating\")";
+        case NodeType::FOLDED:
+            return Expression(static_cast<FoldedExpr*>(node.get())->Original(), tail);
+        case NodeType::IF: {
+            auto if_expr = static_cast<IfExpr*>(node.get());
+            auto test = Expression(if_expr->Test(), false);
+            auto consequent = Expression(if_expr->Consequent(), tail);
+            auto alternative = if_expr->Alternative() ?
+                               Expression(if_expr->Alternative(), tail) : "AotEmpty()";
+            return "(IsTrue(" + test + ") ? " + consequent + " : " + alternative + ")";
+        }
+        case NodeType::DEFINE:
+        case NodeType::SET:
+            return Assign(*static_cast<AssignExpr*>(node.get()),
+                          node->Type() == NodeType::DEFINE);
+        case NodeType::AND:
+        case NodeType::OR:
+            return Logic(static_cast<LogicExpr*>(node.get())->Args(), tail,
+                         node->Type() == NodeType::AND);
+        case NodeType::CALL:
+            return Call(*static_cast<CallExpr*>(node.get()), tail);
+        default:
+            throw SyntaxError("can not compile " + node->ToString());
+    }
+}
+
+std::string CppEmitter::Constant(const ValueType& value) {
+    if (IsBool(value)){
+        return value.AsBool() ? "ValueType(true)" : "ValueType(false)";
+    }
+    if (IsInt(value)){
+        auto number = value.AsInt();
+        if (number == INT64_MIN){
+            constants_.push_back("ValueType(INT64_MIN)");
+        } else {
+            constants_.push_back("ValueType(int64_t(" + IntToString(number) + "LL))");
+        }
+    } else {
+        constants_.push_back("AotRead(" + CppString(value.ToString()) + ")");
+    }
+    return "constant_" + IntToString(constants_.size() - 1);
+}
+
+std::string CppEmitter::SymbolRef(Symbol name) {
+    for (size_t i = 0; i < symbols_.size(); ++i){
+        if (symbols_[i] == name){
+            return "symbol_" + IntToString(i);
+        }
+    }
+    symbols_.push_back(name);
+    return "symbol_" + IntToString(symbols_.size() - 1);
+}
+
+std::string CppEmitter::Lambda(const LambdaExpr& lambda) {
+    auto name = "lambda_" + IntToString(lambda_count_++);
+    std::string body;
+    auto& elements = lambda.Body().Elements();
+    for (size_t i = 0; i + 1 < elements.size(); ++i){
+        body += "    " + Expression(elements[i], false) + ";\n";
+    }
+    body += "    return " + Expression(elements.back(), true) + ";\n";
+    // parameters the body does not use are commented out, the generated
+    // code builds without warnings
+    bool uses_scope = body.find("(scope,") != std::string::npos;
+    bool uses_tail = body.find("AotTail(tail,") != std::string::npos;
+    functions_ += "ValueType " + name + "(const std::shared_ptr<Scope>& " +
+                  (uses_scope ? "scope" : "/*scope*/") + ", AotTailCall* " +
+                  (uses_tail ? "tail" : "/*tail*/") + ") {\n" + body + "}\n\n";
+    return "AotLambda(scope, " + IntToString(lambda.Arity()) + ", " +
+           IntToString(lambda.FrameSize()) + ", " + name + ")";
+}
+
+std::string CppEmitter::Call(const CallExpr& call, bool tail) {
+    // a braced list evaluates the callee and the arguments left to right
+    std::string result = tail ? "AotTail(tail, {" : "AotCall(scope, {";
+    result += Expression(call.Function(), false);
+    for (auto& arg : call.Args()){
+        result += ", " + Expression(arg, false);
+    }
+    return result + "})";
+}
+
+std::string CppEmitter::Assign(const AssignExpr& assign, bool is_define) {
+    auto value = Expression(assign.Value(), false);
+    auto& target = assign.Target();
+    if (target->Type() == NodeType::LOCAL_VAR){
+        auto var = static_cast<LocalVar*>(target.get());
+        auto slot = IntToString(var->Depth()) + ", " + IntToString(var->Index());
+        if (is_define){
+            return "AotDefineLocal(scope, " + slot + ", " + value + ")";
+        }
+        return "AotSetLocal(scope, " + slot + ", " + value + ", " +
+               CppString(var->ToString()) + ")";
+    }
+    auto name = SymbolRef(static_cast<Var*>(target.get())->GetSymbol());
+    return std::string(is_define ? "AotDefineGlobal" : "AotSetGlobal") +
+           "(scope, " + name + ", " + value + ")";
+}
+
+std::string CppEmitter::Logic(const std::vector<NodePtr>& args, bool tail, bool is_and) {
+    if (args.empty()){
+        return is_and ? "ValueType(true)" : "ValueType(false)";
+    }
+    std::string result = "[&]() -> ValueType {\n";
+    for (size_t i = 0; i + 1 < args.size(); ++i){
+        result += "        {\n"
+                  "            auto value = " + Expression(args[i], false) + ";\n" +
+                  "            if (" + (is_and ? "!" : "") + "IsTrue(value)) {\n"
+                  "                return value;\n"
+                  "            }\n"
+                  "        }\n";
+    }
+    return result + "        return " + Expression(args.back(), tail) + ";\n    }()";
+}
+
+std::string CompileToCpp(std::istream* in) {
+    Parser parser(std::make_shared<Tokenizer>(in));
+    Resolver resolver;
+    CppEmitter emitter;
+    while ((*in >> std::ws).peek() != EOF){
+        emitter.AddForm(resolver.Resolve(parser.Parse()));
+    }
+    return emitter.Source();
+}
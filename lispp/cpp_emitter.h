@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "node_types.h"
+
+// Translates expressions rewritten by Resolver into a C++ translation unit
+// against the runtime in aot.h. Every lambda becomes a C++ function of its
+// frame, top-level forms become the body of CompiledProgram.
+class CppEmitter{
+public:
+    void AddForm(const NodePtr& node);
+    std::string Source() const;
+
+private:
+    std::vector<Symbol> symbols_;
+    std::vector<std::string> constants_;
+    std::string functions_;
+    std::string forms_;
+    size_t lambda_count_ = 0;
+
+    std::string Expression(const NodePtr& node, bool tail);
+    std::string Constant(const ValueType& value);
+    std::string SymbolRef(Symbol name);
+    std::string Lambda(const LambdaExpr& lambda);
+    std::string Call(const CallExpr& call, bool tail);
+    std::string Assign(const AssignExpr& assign, bool is_define);
+    std::string Logic(const std::vector<NodePtr>& args, bool tail, bool is_and);
+};
+
+// reads every expression from in and returns the generated C++ source
+std::string CompileToCpp(std::istream* in);
@@ -0,0 +1,125 @@
+#include "folder.h"
+
+#include <stdexcept>
+
+ConstantFolder::ConstantFolder(std::shared_ptr<Scope> global_scope) :
+        global_scope_(std::move(global_scope)) {}
+
+NodePtr ConstantFolder::Fold(const NodePtr& node) {
+    switch (node->Type()){
+        case NodeType::CALL:
+            return FoldCall(*static_cast<CallExpr*>(node.get()));
+        case NodeType::IF:
+            return FoldIf(*static_cast<IfExpr*>(node.get()));
+        case NodeType::DEFINE:
+        case NodeType::SET: {
+            auto assign = static_cast<AssignExpr*>(node.get());
+            return NodePtr(new AssignExpr(node->Type() == NodeType::DEFINE,
+                                          assign->Target(), Fold(assign->Value())));
+        }
+        case NodeType::AND:
+        case NodeType::OR:
+            return NodePtr(new LogicExpr(node->Type() == NodeType::AND,
+                                         FoldAll(static_cast<LogicExpr*>(node.get())->Args())));
+        case NodeType::LAMBDA_EXPR:
+            return FoldLambda(*static_cast<LambdaExpr*>(node.get()));
+        default:
+            return node;
+    }
+}
+
+std::vector<NodePtr> ConstantFolder::FoldAll(const std::vector<NodePtr>& nodes) {
+    std::vector<NodePtr> result;
+    result.reserve(nodes.size());
+    for (auto& node : nodes){
+        result.push_back(Fold(node));
+    }
+    return result;
+}
+
+NodePtr ConstantFolder::FoldCall(const CallExpr& call) {
+    auto args = FoldAll(call.Args());
+    NodePtr folded(new CallExpr(call.Function(), args));
+    auto& function = call.Function();
+    if (function->Type() != NodeType::VAR){
+        return folded;
+    }
+    auto name = static_cast<Var*>(function.get())->GetSymbol();
+    auto binding = global_scope_->GetBinding(name);
+    if (!binding || binding->GetType() != ValueType::ValueEnum::FUNC){
+        return folded;
+    }
+    auto primitive = dynamic_cast<PurePrimitive*>(binding->AsNode());
+    if (!primitive){
+        return folded;
+    }
+
+    std::vector<std::pair<Symbol, NodePtr>> guards{{name, NodePtr(primitive)}};
+    std::vector<ValueType> values;
+    for (auto& arg : args){
+        if (arg->Type() == NodeType::CONST){
+            values.push_back(arg->ComputeValue(global_scope_));
+        } else if (arg->Type() == NodeType::FOLDED &&
+                   !static_cast<FoldedExpr*>(arg.get())->Taken()){
+            auto inner = static_cast<FoldedExpr*>(arg.get());
+            values.push_back(inner->Value());
+            guards.insert(guards.end(), inner->Guards().begin(), inner->Guards().end());
+        } else {
+            return folded;
+        }
+    }
+    ValueType value;
+    try {
+        value = primitive->Apply(ArgSpan(values.data(), values.size()));
+    } catch (const std::runtime_error&) {
+        // the error is raised when the call is evaluated
+        return folded;
+    }
+    return NodePtr(new FoldedExpr(std::move(value), std::move(guards), std::move(folded)));
+}
+
+NodePtr ConstantFolder::FoldIf(const IfExpr& node) {
+    auto test = Fold(node.Test());
+    auto consequent = Fold(node.Consequent());
+    auto alternative = node.Alternative() ? Fold(node.Alternative()) : NodePtr();
+    if (test->Type() == NodeType::CONST){
+        return TakenBranch(IsTrue(test->ComputeValue(global_scope_)), consequent, alternative);
+    }
+    auto folded = test->Type() == NodeType::FOLDED ? static_cast<FoldedExpr*>(test.get()) : nullptr;
+    if (!folded || folded->Taken()){
+        return NodePtr(new IfExpr(std::move(test), std::move(consequent),
+                                  std::move(alternative)));
+    }
+    // the branch is taken while the builtins the test was folded with are
+    // bound, otherwise the if is evaluated
+    auto guards = folded->Guards();
+    auto taken = TakenBranch(IsTrue(folded->Value()), consequent, alternative);
+    NodePtr original(new IfExpr(test, std::move(consequent), std::move(alternative)));
+    if (taken->Type() == NodeType::CONST){
+        return NodePtr(new FoldedExpr(taken->ComputeValue(global_scope_), std::move(guards),
+                                      std::move(original)));
+    }
+    if (taken->Type() == NodeType::FOLDED && !static_cast<FoldedExpr*>(taken.get())->Taken()){
+        auto inner = static_cast<FoldedExpr*>(taken.get());
+        guards.insert(guards.end(), inner->Guards().begin(), inner->Guards().end());
+        return NodePtr(new FoldedExpr(inner->Value(), std::move(guards), std::move(original)));
+    }
+    return NodePtr(new FoldedExpr(ValueType(), std::move(guards), std::move(original),
+                                  std::move(taken)));
+}
+
+NodePtr ConstantFolder::TakenBranch(bool test, const NodePtr& consequent,
+                                    const NodePtr& alternative) {
+    if (test){
+        return consequent;
+    }
+    if (!alternative){
+        return NodePtr(new Const(ValueType(NodePtr(new Empty()))));
+    }
+    return alternative;
+}
+
+NodePtr ConstantFolder::FoldLambda(const LambdaExpr& lambda) {
+    NodePtr body(new FuncList(FoldAll(lambda.Body().Elements())));
+    return NodePtr(new LambdaExpr(lambda.Names(), lambda.Arity(), std::move(body)));
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "node_types.h"
+
+// Rewrites an expression produced by Resolver, computing ahead of time
+// calls of pure builtins whose arguments are all constants and choosing
+// the branch of an if whose test is a literal or such a call. A folded
+// expression keeps its original expression and the builtins it was folded
+// with (see FoldedExpr), so redefining them through define or set! is
+// still observed.
+class ConstantFolder{
+public:
+    explicit ConstantFolder(std::shared_ptr<Scope> global_scope);
+    NodePtr Fold(const NodePtr& node);
+
+private:
+    std::shared_ptr<Scope> global_scope_;
+
+    NodePtr FoldCall(const CallExpr& call);
+    NodePtr FoldIf(const IfExpr& node);
+    // the branch of an if chosen by the value of its test
+    static NodePtr TakenBranch(bool test, const NodePtr& consequent, const NodePtr& alternative);
+    NodePtr FoldLambda(const LambdaExpr& lambda);
+    std::vector<NodePtr> FoldAll(const std::vector<NodePtr>& nodes);
+};
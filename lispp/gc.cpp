@@ -0,0 +1,652 @@
+#include "gc.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+// objects allocated between two minor collections
+const size_t kNurserySize = 32768;
+// old objects which start a full collection, at least twice as many as
+// survived the last one
+const size_t kMinOldThreshold = 100000;
+// objects allocated between two steps of incremental marking
+const size_t kMarkStepSize = 1024;
+// objects traced between two looks at the clock
+const size_t kDeadlineCheckInterval = 64;
+
+template <class F>
+class FunctionTracer : public Tracer{
+public:
+    explicit FunctionTracer(F visit) : visit_(std::move(visit)) {}
+
+    void Visit(GcObject* object) override {
+        visit_(object);
+    }
+
+private:
+    F visit_;
+};
+
+template <class F>
+FunctionTracer<F> MakeTracer(F visit) {
+    return FunctionTracer<F>(std::move(visit));
+}
+}
+
+thread_local Heap* Heap::current_ = nullptr;
+
+void* GcAllocate(size_t size) {
+    auto heap = Heap::Current();
+    size += sizeof(ObjectPool*);
+    ObjectPool* pool = nullptr;
+    void* block;
+    if (heap){
+        heap->Reserve(size);
+        pool = heap->Pool();
+        block = pool->Allocate(size);
+    } else {
+        block = ::operator new(size);
+    }
+    // the pool the block came from is kept in front of it
+    auto prefix = static_cast<ObjectPool**>(block);
+    *prefix = pool;
+    return prefix + 1;
+}
+
+void GcFree(void* ptr, size_t size) {
+    auto heap = Heap::Current();
+    if (heap && heap->concurrent_){
+        heap->deferred_frees_.emplace_back(ptr, size);
+        return;
+    }
+    auto prefix = static_cast<ObjectPool**>(ptr) - 1;
+    if (*prefix){
+        (*prefix)->Free(prefix, size + sizeof(ObjectPool*));
+    } else {
+        ::operator delete(prefix);
+    }
+}
+
+void GcDestroy(GcObject* object) {
+    auto heap = object->GetHeap();
+    if (heap && heap->concurrent_){
+        heap->deferred_destroys_.push_back(object);
+    } else {
+        object->~GcObject();
+    }
+}
+
+ObjectPool::~ObjectPool() {
+    for (auto chunk : chunks_){
+        delete[] chunk;
+    }
+}
+
+void* ObjectPool::Allocate(size_t size) {
+    if (size > kMaxPooledSize){
+        auto block = ::operator new(size);
+        ++live_blocks_;
+        live_bytes_ += size;
+        return block;
+    }
+    size_t size_class = (size - 1) / kPoolGranule;
+    size_t block_size = (size_class + 1) * kPoolGranule;
+    ++live_blocks_;
+    live_bytes_ += block_size;
+    auto free_block = arenas_ ? nullptr : free_lists_[size_class];
+    if (free_block){
+        free_lists_[size_class] = free_block->next;
+        return free_block;
+    }
+    if (static_cast<size_t>(limit_ - bump_) < block_size){
+        chunks_.push_back(new char[kChunkSize]);
+        bump_ = chunks_.back();
+        limit_ = bump_ + kChunkSize;
+    }
+    auto block = bump_;
+    bump_ += block_size;
+    return block;
+}
+
+void ObjectPool::Free(void* ptr, size_t size) {
+    if (size > kMaxPooledSize){
+        ::operator delete(ptr);
+        live_bytes_ -= size;
+    } else {
+        size_t size_class = (size - 1) / kPoolGranule;
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = free_lists_[size_class];
+        free_lists_[size_class] = block;
+        live_bytes_ -= (size_class + 1) * kPoolGranule;
+    }
+    if (--live_blocks_ == 0 && orphaned_){
+        delete this;
+    }
+}
+
+void ObjectPool::Orphan() {
+    orphaned_ = true;
+    if (live_blocks_ == 0){
+        delete this;
+    }
+}
+
+size_t ObjectPool::LiveBlocks() const {
+    return live_blocks_;
+}
+
+size_t ObjectPool::LiveBytes() const {
+    return live_bytes_;
+}
+
+size_t ObjectPool::ReservedBytes() const {
+    return chunks_.size() * kChunkSize;
+}
+
+PoolArena::PoolArena(ObjectPool* pool) : pool_(pool) {
+    if (pool_){
+        ++pool_->arenas_;
+    }
+}
+
+PoolArena::~PoolArena() {
+    if (pool_){
+        --pool_->arenas_;
+    }
+}
+
+GcObject::GcObject() : heap_(Heap::Current()) {
+    if (heap_){
+        heap_->Register(this);
+    }
+}
+
+GcObject::~GcObject() {
+    if (heap_){
+        heap_->Unregister(this);
+    }
+}
+
+void PauseHistogram::Record(std::chrono::nanoseconds pause) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(pause).count();
+    size_t bucket = 0;
+    while (bucket + 1 < kBuckets && (int64_t(1) << bucket) <= micros){
+        ++bucket;
+    }
+    ++buckets[bucket];
+    ++pauses;
+    total += pause;
+    max = std::max(max, pause);
+}
+
+Heap::Heap(GcConfig config) :
+        config_(config), pool_(new ObjectPool()), old_threshold_(kMinOldThreshold),
+        created_(std::chrono::steady_clock::now()) {}
+
+Heap::~Heap() {
+    if (concurrent_){
+        StopConcurrentMarking();
+    }
+    for (auto& list : lists_){
+        for (auto object = list.head; object; object = object->next_){
+            object->heap_ = nullptr;
+        }
+    }
+    // blocks of the objects left are freed into the pool later
+    pool_->Orphan();
+}
+
+size_t Heap::AddRoots(RootSet roots) {
+    roots_.emplace(next_root_id_, std::move(roots));
+    return next_root_id_++;
+}
+
+void Heap::RemoveRoots(size_t id) {
+    roots_.erase(id);
+}
+
+size_t Heap::Collect() {
+    if (collecting_){
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    collecting_ = true;
+    if (concurrent_){
+        StopConcurrentMarking();
+    }
+    if (!marking_){
+        marking_ = true;
+        MarkRoots();
+    }
+    auto freed = FinishMarking();
+    collecting_ = false;
+    pauses_.Record(std::chrono::steady_clock::now() - start);
+    return freed;
+}
+
+size_t Heap::CollectMinor() {
+    if (collecting_ || marking_){
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    collecting_ = true;
+    std::vector<GcObject*> candidates;
+    for (auto object = lists_[young_].head; object; object = object->next_){
+        candidates.push_back(object);
+    }
+    auto freed = Sweep(candidates, true);
+    while (auto object = lists_[black_].head){
+        Move(object, old_);
+    }
+    ++minor_collections_;
+    allocated_ = 0;
+    pending_ = false;
+    collecting_ = false;
+    pauses_.Record(std::chrono::steady_clock::now() - start);
+    return freed;
+}
+
+void Heap::StartCollection() {
+    if (collecting_ || marking_){
+        return;
+    }
+    if (config_.concurrent){
+        StartConcurrentMarking();
+        return;
+    }
+    if (config_.max_pause.count() == 0){
+        Collect();
+        return;
+    }
+    marking_ = true;
+    MarkRoots();
+    allocated_ = 0;
+}
+
+const GcConfig& Heap::Config() const {
+    return config_;
+}
+
+void Heap::SetConfig(const GcConfig& config) {
+    config_ = config;
+}
+
+const PauseHistogram& Heap::Pauses() const {
+    return pauses_;
+}
+
+ObjectPool* Heap::Pool() const {
+    return pool_;
+}
+
+size_t Heap::ObjectCount() const {
+    size_t count = 0;
+    for (auto& list : lists_){
+        count += list.count;
+    }
+    return count;
+}
+
+size_t Heap::YoungCount() const {
+    return lists_[young_].count;
+}
+
+size_t Heap::Collections() const {
+    return collections_;
+}
+
+size_t Heap::MinorCollections() const {
+    return minor_collections_;
+}
+
+size_t Heap::BytesAllocated() const {
+    return bytes_allocated_;
+}
+
+size_t Heap::ObjectsAllocated() const {
+    return objects_allocated_;
+}
+
+std::chrono::steady_clock::duration Heap::Age() const {
+    return std::chrono::steady_clock::now() - created_;
+}
+
+void Heap::ForEachObject(const std::function<void(GcObject* object)>& visit) const {
+    for (auto& list : lists_){
+        for (auto object = list.head; object; object = object->next_){
+            visit(object);
+        }
+    }
+}
+
+void Heap::Register(GcObject* object) {
+    if (concurrent_){
+        // the marker skips objects allocated after it started; the mark is
+        // stored before the object can be published to it
+        object->mark_.store(epoch_, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    ++objects_allocated_;
+    // objects allocated while marking are black
+    Link(marking_ ? black_ : young_, object);
+    if (++allocated_ >= (marking_ ? kMarkStepSize : kNurserySize)){
+        pending_ = true;
+    }
+}
+
+void Heap::Unregister(GcObject* object) {
+    Unlink(object);
+}
+
+void Heap::Link(uint8_t list, GcObject* object) {
+    auto& objects = lists_[list];
+    object->list_ = list;
+    object->prev_ = nullptr;
+    object->next_ = objects.head;
+    if (objects.head){
+        objects.head->prev_ = object;
+    }
+    objects.head = object;
+    ++objects.count;
+}
+
+void Heap::Unlink(GcObject* object) {
+    auto& objects = lists_[object->list_];
+    if (object->prev_){
+        object->prev_->next_ = object->next_;
+    } else {
+        objects.head = object->next_;
+    }
+    if (object->next_){
+        object->next_->prev_ = object->prev_;
+    }
+    --objects.count;
+}
+
+void Heap::Move(GcObject* object, uint8_t list) {
+    Unlink(object);
+    Link(list, object);
+}
+
+void Heap::Reserve(size_t size) {
+    bytes_allocated_ += size;
+    auto limit = config_.memory_limit;
+    if (!limit || pool_->LiveBytes() + size <= limit){
+        if (UnderPressure()){
+            pending_ = true;
+        }
+        return;
+    }
+    if (concurrent_){
+        // frees delayed for the marker may bring the heap under the limit;
+        // the next safepoint finishes the collection
+        StopConcurrentMarking();
+        pending_ = true;
+        if (pool_->LiveBytes() + size <= limit){
+            return;
+        }
+    }
+    throw RuntimeError("memory limit of " + std::to_string(limit) + " bytes exceeded");
+}
+
+bool Heap::UnderPressure() const {
+    auto limit = config_.memory_limit;
+    if (!limit){
+        return false;
+    }
+    // halfway between what survived the last full collection and the limit,
+    // but not before three quarters of it
+    auto live = std::min(live_after_collection_, limit);
+    auto threshold = std::max(limit / 4 * 3, live + (limit - live) / 2);
+    return pool_->LiveBytes() > threshold;
+}
+
+void Heap::CollectPending() {
+    if (collecting_){
+        return;
+    }
+    if (concurrent_){
+        if (marker_done_.load(std::memory_order_acquire)){
+            Collect();
+        } else {
+            allocated_ = 0;
+            pending_ = false;
+        }
+        return;
+    }
+    if (!marking_ && lists_[old_].count < old_threshold_ && !UnderPressure()){
+        CollectMinor();
+        return;
+    }
+    if (!marking_ && config_.concurrent){
+        StartConcurrentMarking();
+        return;
+    }
+    if (config_.max_pause.count() == 0){
+        Collect();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    collecting_ = true;
+    if (!marking_){
+        marking_ = true;
+        MarkRoots();
+    }
+    if (Drain(false, start + config_.max_pause)){
+        FinishMarking();
+    }
+    allocated_ = 0;
+    pending_ = false;
+    collecting_ = false;
+    pauses_.Record(std::chrono::steady_clock::now() - start);
+}
+
+void Heap::Mark(GcObject* object, bool young_only) {
+    if (object && object->heap_ == this && !IsMarked(object) &&
+            !(young_only && object->list_ != young_)){
+        Move(object, grey_);
+    }
+}
+
+void Heap::MarkRoots() {
+    auto marker = MakeTracer([this](GcObject* object) {
+        Mark(object);
+    });
+    for (auto& roots : roots_){
+        roots.second(&marker);
+    }
+}
+
+bool Heap::Drain(bool young_only, std::chrono::steady_clock::time_point deadline) {
+    auto marker = MakeTracer([this, young_only](GcObject* object) {
+        Mark(object, young_only);
+    });
+    size_t traced = 0;
+    while (auto object = lists_[grey_].head){
+        Move(object, black_);
+        object->Trace(&marker);
+        if (++traced % kDeadlineCheckInterval == 0 &&
+                std::chrono::steady_clock::now() >= deadline){
+            return !lists_[grey_].head;
+        }
+    }
+    return true;
+}
+
+size_t Heap::FinishMarking() {
+    // roots and stores without a barrier may refer to white objects
+    MarkRoots();
+    Drain();
+    std::vector<GcObject*> candidates;
+    for (auto list : {young_, old_}){
+        for (auto object = lists_[list].head; object; object = object->next_){
+            candidates.push_back(object);
+        }
+    }
+    auto freed = Sweep(candidates, false);
+    // every object left is black
+    std::swap(old_, black_);
+    marking_ = false;
+    ++collections_;
+    allocated_ = 0;
+    pending_ = false;
+    old_threshold_ = std::max(kMinOldThreshold, 2 * lists_[old_].count);
+    live_after_collection_ = pool_->LiveBytes();
+    return freed;
+}
+
+size_t Heap::Sweep(const std::vector<GcObject*>& candidates, bool young_only) {
+    // candidates are referenced from the native stack, from objects which
+    // are not traced, from marked or old objects or only from each other
+    std::vector<GcObject*> white;
+    for (auto object : candidates){
+        object->gc_refs_ = object->GcRefCount();
+        if (object->gc_refs_ == 0){
+            // not owned yet, e.g. just allocated
+            Mark(object, young_only);
+        } else {
+            white.push_back(object);
+        }
+    }
+    Drain(young_only);
+    auto internal = MakeTracer([this, young_only](GcObject* object) {
+        if (object && object->heap_ == this && !IsMarked(object) &&
+                !(young_only && object->list_ != young_)){
+            --object->gc_refs_;
+        }
+    });
+    for (auto object : white){
+        if (!IsMarked(object)){
+            object->Trace(&internal);
+        }
+    }
+    for (auto object : white){
+        if (!IsMarked(object) && object->gc_refs_ > 0){
+            Mark(object, young_only);
+            Drain(young_only);
+        }
+    }
+
+    std::vector<GcObject*> garbage;
+    for (auto object : white){
+        if (!IsMarked(object)){
+            garbage.push_back(object);
+        }
+    }
+    // garbage objects are held while their references are dropped, so none
+    // of them is freed before its own references are cleared
+    for (auto object : garbage){
+        object->GcRetain();
+    }
+    for (auto object : garbage){
+        object->ClearReferences();
+    }
+    for (auto object : garbage){
+        object->GcRelease();
+    }
+    return garbage.size();
+}
+
+void Heap::Remember(GcObject* object) {
+    std::lock_guard<std::mutex> lock(remembered_mutex_);
+    remembered_.push_back(object);
+}
+
+void Heap::StartConcurrentMarking() {
+    auto start = std::chrono::steady_clock::now();
+    marking_ = true;
+    concurrent_ = true;
+    ++epoch_;
+    stop_marker_ = false;
+    marker_done_ = false;
+    std::vector<GcObject*> roots;
+    auto root_marker = MakeTracer([this, &roots](GcObject* object) {
+        if (Shade(object)){
+            roots.push_back(object);
+        }
+    });
+    for (auto& root_set : roots_){
+        root_set.second(&root_marker);
+    }
+    // the roots themselves are traced in this pause, so the marker never
+    // reads the table of the global scope, which define may grow
+    auto marker = MakeTracer([this](GcObject* object) {
+        if (Shade(object)){
+            mark_stack_.push_back(object);
+        }
+    });
+    for (auto object : roots){
+        object->Trace(&marker);
+    }
+    marker_ = std::thread(&Heap::MarkConcurrently, this);
+    allocated_ = 0;
+    pending_ = false;
+    pauses_.Record(std::chrono::steady_clock::now() - start);
+}
+
+void Heap::StopConcurrentMarking() {
+    stop_marker_ = true;
+    marker_.join();
+    concurrent_ = false;
+    // objects the marker has reached are black, unless they are still to be
+    // traced
+    for (auto list : {young_, old_}){
+        for (auto object = lists_[list].head; object;){
+            auto next = object->next_;
+            if (object->mark_.load(std::memory_order_relaxed) == epoch_){
+                Move(object, black_);
+            }
+            object = next;
+        }
+    }
+    for (auto pending : {&mark_stack_, &remembered_}){
+        for (auto object : *pending){
+            Move(object, grey_);
+        }
+        pending->clear();
+    }
+    // nothing reads the objects freed meanwhile any more
+    auto destroys = std::move(deferred_destroys_);
+    auto deletes = std::move(deferred_deletes_);
+    auto frees = std::move(deferred_frees_);
+    for (auto object : destroys){
+        object->~GcObject();
+    }
+    for (auto object : deletes){
+        delete object;
+    }
+    for (auto& block : frees){
+        GcFree(block.first, block.second);
+    }
+}
+
+void Heap::MarkConcurrently() {
+    auto marker = MakeTracer([this](GcObject* object) {
+        if (Shade(object)){
+            mark_stack_.push_back(object);
+        }
+    });
+    while (!stop_marker_.load(std::memory_order_relaxed)){
+        if (mark_stack_.empty()){
+            std::lock_guard<std::mutex> lock(remembered_mutex_);
+            if (remembered_.empty()){
+                break;
+            }
+            mark_stack_.swap(remembered_);
+            continue;
+        }
+        auto object = mark_stack_.back();
+        mark_stack_.pop_back();
+        object->Trace(&marker);
+    }
+    marker_done_.store(true, std::memory_order_release);
+}
+
+HeapScope::HeapScope(Heap* heap) : previous_(Heap::current_) {
+    Heap::current_ = heap;
+}
+
+HeapScope::~HeapScope() {
+    Heap::current_ = previous_;
+}
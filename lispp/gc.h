@@ -0,0 +1,496 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Tracing collector for the objects of one interpreter. Nodes and scopes
+// are still reference counted, so acyclic garbage is freed as soon as it is
+// dropped; the collector frees the cycles reference counting cannot, such
+// as a closure and the frame it was defined in, or a list made circular by
+// set-cdr!.
+//
+// Every GcObject allocated while a heap is current on the thread is linked
+// into that heap. A collection marks the objects reachable from the roots
+// (the global scope, the evaluation stacks and the handles of embedders).
+// The evaluator also holds counted references on the native stack which are
+// not reported as roots; an unmarked object whose reference count is higher
+// than the number of references from other unmarked objects is held from
+// such a place, so it and the objects reachable from it are marked too.
+// What is left unmarked is referenced only from itself: the references of
+// these objects are dropped, which frees them.
+//
+// Objects are young until they survive a collection. A minor collection
+// looks only at young objects: references from old objects are counted
+// like references from the stack, so it needs no roots and no barriers.
+// Survivors are promoted in place; objects are never moved, because
+// tagged words, native frames and JIT code hold their addresses.
+//
+// A full collection may also mark incrementally: GcConfig::max_pause bounds
+// each step, and steps are taken at safepoints while objects are
+// allocated. Objects allocated while marking are black. Storing a reference
+// into a marked object through set-car!, set-cdr!, or set! and define of a
+// global or a local (Scope::StoreSlot) shades the stored object, so it is
+// marked by the steps instead of by the final pause; other stores, such as
+// binding arguments or the JIT reusing a frame, are safe without a barrier,
+// since the final pause keeps every unmarked object which is still
+// referenced from outside the unmarked ones.
+//
+// With GcConfig::concurrent the marking of a full collection runs on a
+// background thread instead. The first pause marks the roots and the
+// objects they refer to; then the evaluator keeps running while the marker
+// traces the rest of the heap as it was at that moment (snapshot at the
+// beginning): the same stores shade the value they overwrite, and objects
+// allocated meanwhile are marked. The words the marker reads while the
+// evaluator runs are the tagged ValueType words of pairs and frame slots
+// and the JIT code of a lambda, which are atomic; the node references of
+// the tree are not changed after a node is made, and the table of the
+// global scope is traced in the first pause. Objects freed by reference counting are kept until the marker
+// stops, since it may still be reading them. Once it is done, the next
+// safepoint finishes the collection in one pause like the incremental mode.
+//
+// Memory of nodes and scopes comes from the ObjectPool of the current heap:
+// a freed block is reused by the next object of its size class, otherwise
+// blocks are bump allocated from the current chunk. Slot tables, runs of
+// pairs and the stacks of VM and CekMachine are GcVectors drawn from the
+// same pool. The pool counts the bytes in use, which GcConfig::memory_limit
+// bounds: an allocation past the limit throws RuntimeError, and a full
+// collection starts at the next safepoint once the heap gets close to it.
+// The native stack of the tree walker and closure code is not counted.
+
+class Heap;
+class GcObject;
+
+// memory for objects of a heap, also used by GcAllocator; falls back to
+// operator new when no heap is current
+void* GcAllocate(size_t size);
+void GcFree(void* ptr, size_t size);
+// runs the destructor of object, which must have been allocated by a
+// GcAllocator
+void GcDestroy(GcObject* object);
+
+template <class T>
+class GcAllocator{
+public:
+    using value_type = T;
+
+    GcAllocator() = default;
+
+    template <class U>
+    GcAllocator(const GcAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(GcAllocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        GcFree(ptr, n * sizeof(T));
+    }
+
+    template <class U>
+    void destroy(U* ptr) {
+        Destroy(ptr, std::is_base_of<GcObject, U>());
+    }
+
+private:
+    template <class U>
+    static void Destroy(U* ptr, std::true_type) {
+        GcDestroy(ptr);
+    }
+
+    template <class U>
+    static void Destroy(U* ptr, std::false_type) {
+        ptr->~U();
+    }
+};
+
+template <class T, class U>
+bool operator==(const GcAllocator<T>&, const GcAllocator<U>&) {
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const GcAllocator<T>&, const GcAllocator<U>&) {
+    return false;
+}
+
+// vector whose storage counts against the memory limit of the heap current
+// when it grows, for the evaluator stacks and the tables owned by objects
+template <class T>
+using GcVector = std::vector<T, GcAllocator<T>>;
+
+// blocks of up to kMaxPooledSize bytes in size classes of kPoolGranule,
+// larger ones come from operator new
+class ObjectPool{
+public:
+    static const size_t kPoolGranule = 16;
+    static const size_t kMaxPooledSize = 512;
+    static const size_t kChunkSize = 64 * 1024;
+
+    ~ObjectPool();
+    void* Allocate(size_t size);
+    void Free(void* ptr, size_t size);
+    // frees the pool once its last block is freed
+    void Orphan();
+    size_t LiveBlocks() const;
+    // bytes of the blocks in use, including the size class rounding
+    size_t LiveBytes() const;
+    // bytes of the chunks blocks are cut from
+    size_t ReservedBytes() const;
+
+private:
+    friend class PoolArena;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* free_lists_[kMaxPooledSize / kPoolGranule] = {};
+    char* bump_ = nullptr;
+    char* limit_ = nullptr;
+    std::vector<char*> chunks_;
+    size_t live_blocks_ = 0;
+    size_t live_bytes_ = 0;
+    // free lists are bypassed while an arena is open
+    size_t arenas_ = 0;
+    bool orphaned_ = false;
+};
+
+// while it exists, blocks of pool are bump allocated even if freed ones
+// could be reused, so the objects made meanwhile, such as the tree of a
+// parsed form, are laid out contiguously in the order they are made;
+// each of them is still freed on its own
+class PoolArena{
+public:
+    // pool may be null, then there is nothing to do
+    explicit PoolArena(ObjectPool* pool);
+    ~PoolArena();
+    PoolArena(const PoolArena&) = delete;
+    PoolArena& operator=(const PoolArena&) = delete;
+
+private:
+    ObjectPool* pool_;
+};
+
+// receives the references reported by Trace and by root sets
+class Tracer{
+public:
+    virtual ~Tracer() = default;
+    virtual void Visit(GcObject* object) = 0;
+};
+
+class GcObject{
+public:
+    // links the object into the current heap, if any
+    GcObject();
+    GcObject(const GcObject&) = delete;
+    GcObject& operator=(const GcObject&) = delete;
+    virtual ~GcObject();
+
+    // reports every reference counted by GcRefCount() that the object holds
+    virtual void Trace(Tracer*) {}
+    // drops the references reported by Trace
+    virtual void ClearReferences() {}
+    virtual size_t GcRefCount() const = 0;
+    // keep a garbage object alive while its cycle is being broken
+    virtual void GcRetain() = 0;
+    virtual void GcRelease() = 0;
+
+    Heap* GetHeap() const {
+        return heap_;
+    }
+
+    static void* operator new(size_t size) {
+        return GcAllocate(size);
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        GcFree(ptr, size);
+    }
+
+private:
+    friend class Heap;
+    Heap* heap_;
+    GcObject* prev_ = nullptr;
+    GcObject* next_ = nullptr;
+    // list of the heap the object is in
+    uint8_t list_ = 0;
+    // epoch of the last background marking which reached the object
+    std::atomic<uint32_t> mark_{0};
+    size_t gc_refs_ = 0;
+};
+
+// object owned through std::shared_ptr and made by MakeShared, which
+// leaves a weak reference to it for the collector to count the owners
+template <class T>
+class SharedGcObject : public GcObject{
+public:
+    size_t GcRefCount() const override {
+        return self_.use_count();
+    }
+
+    void GcRetain() override {
+        gc_hold_ = self_.lock();
+    }
+
+    void GcRelease() override {
+        // may free this object
+        auto hold = std::move(gc_hold_);
+    }
+
+private:
+    template <class U, class... Args>
+    friend std::shared_ptr<U> MakeShared(Args&&... args);
+    std::weak_ptr<T> self_;
+    std::shared_ptr<T> gc_hold_;
+};
+
+// object allocated together with its control block from the current heap
+template <class T, class... Args>
+std::shared_ptr<T> MakeShared(Args&&... args) {
+    auto object = std::allocate_shared<T>(GcAllocator<T>(), std::forward<Args>(args)...);
+    static_cast<SharedGcObject<T>*>(object.get())->self_ = object;
+    return object;
+}
+
+struct GcConfig {
+    // longest step of a full collection, zero collects the whole heap in
+    // one pause
+    std::chrono::microseconds max_pause{0};
+    // mark on a background thread, max_pause is then ignored
+    bool concurrent = false;
+    // bytes the objects of the heap may take, zero for no limit
+    size_t memory_limit = 0;
+};
+
+// pauses of a heap by duration: bucket i counts the pauses shorter than
+// 2^i microseconds, the last bucket all the longer ones
+struct PauseHistogram {
+    static const size_t kBuckets = 24;
+    size_t buckets[kBuckets] = {};
+    size_t pauses = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+
+    void Record(std::chrono::nanoseconds pause);
+};
+
+class Heap{
+public:
+    using RootSet = std::function<void(Tracer* tracer)>;
+
+    explicit Heap(GcConfig config = GcConfig());
+    // objects which outlive the heap are unlinked and left to reference
+    // counting
+    ~Heap();
+
+    // heap new objects of this thread are linked into, null if none
+    static Heap* Current() {
+        return current_;
+    }
+
+    // roots is called by every collection until RemoveRoots(id)
+    size_t AddRoots(RootSet roots);
+    void RemoveRoots(size_t id);
+
+    // full collection, finishing the incremental one if it is marking;
+    // returns the number of objects freed
+    size_t Collect();
+    // collection of young objects only, does nothing while marking
+    size_t CollectMinor();
+    // starts a full collection which safepoints finish in steps of at most
+    // GcConfig::max_pause or once the background marker is done, or
+    // collects at once if neither is configured
+    void StartCollection();
+
+    // a minor collection once kNurserySize objects were allocated since the
+    // last one, a full one when the old generation has doubled; while a
+    // full collection marks incrementally, a step every kMarkStepSize
+    // allocations, and while it marks in the background, a check whether
+    // the marker is done. Called by the evaluators where every live object
+    // is referenced.
+    void Safepoint() {
+        if (pending_){
+            CollectPending();
+        }
+    }
+
+    bool IsMarking() const {
+        return marking_;
+    }
+
+    // called before value replaces old in holder
+    void WriteBarrier(GcObject* holder, GcObject* old, GcObject* value) {
+        if (!marking_){
+            return;
+        }
+        if (concurrent_){
+            if (Shade(old)){
+                Remember(old);
+            }
+        } else if (value && IsMarked(holder) && value->heap_ == this && !IsMarked(value)){
+            Mark(value);
+        }
+    }
+
+    const GcConfig& Config() const;
+    void SetConfig(const GcConfig& config);
+    const PauseHistogram& Pauses() const;
+    ObjectPool* Pool() const;
+    size_t ObjectCount() const;
+    size_t YoungCount() const;
+    size_t Collections() const;
+    size_t MinorCollections() const;
+    // totals since the heap was created, freed memory included
+    size_t BytesAllocated() const;
+    size_t ObjectsAllocated() const;
+    std::chrono::steady_clock::duration Age() const;
+    // calls visit for every object of the heap, including garbage which
+    // has not been collected yet
+    void ForEachObject(const std::function<void(GcObject* object)>& visit) const;
+
+private:
+    friend class GcObject;
+    friend class HeapScope;
+    friend void* GcAllocate(size_t size);
+    friend void GcFree(void* ptr, size_t size);
+    friend void GcDestroy(GcObject* object);
+    friend void GcDelete(GcObject* object);
+
+    struct ObjectList {
+        GcObject* head = nullptr;
+        size_t count = 0;
+    };
+
+    static thread_local Heap* current_;
+    GcConfig config_;
+    ObjectPool* pool_;
+    // white objects are in young_ and old_, marked ones in grey_ until they
+    // are traced and then in black_; a full collection leaves only black
+    // objects, which become old by swapping old_ and black_
+    ObjectList lists_[4];
+    uint8_t young_ = 0;
+    uint8_t old_ = 1;
+    uint8_t grey_ = 2;
+    uint8_t black_ = 3;
+    size_t allocated_ = 0;
+    size_t old_threshold_;
+    bool pending_ = false;
+    bool collecting_ = false;
+    bool marking_ = false;
+    size_t collections_ = 0;
+    size_t minor_collections_ = 0;
+    size_t bytes_allocated_ = 0;
+    size_t objects_allocated_ = 0;
+    // bytes in use after the last full collection
+    size_t live_after_collection_ = 0;
+    std::chrono::steady_clock::time_point created_;
+    PauseHistogram pauses_;
+    std::unordered_map<size_t, RootSet> roots_;
+    size_t next_root_id_ = 0;
+
+    // background marking; the marker owns mark_stack_ until it is joined
+    bool concurrent_ = false;
+    uint32_t epoch_ = 0;
+    std::thread marker_;
+    std::atomic<bool> stop_marker_{false};
+    std::atomic<bool> marker_done_{false};
+    std::vector<GcObject*> mark_stack_;
+    // objects shaded by the write barrier, for the marker to trace
+    std::mutex remembered_mutex_;
+    std::vector<GcObject*> remembered_;
+    // frees delayed while the marker may read the memory
+    std::vector<GcObject*> deferred_destroys_;
+    std::vector<GcObject*> deferred_deletes_;
+    std::vector<std::pair<void*, size_t>> deferred_frees_;
+
+    void Register(GcObject* object);
+    void Unregister(GcObject* object);
+    void Link(uint8_t list, GcObject* object);
+    void Unlink(GcObject* object);
+    void Move(GcObject* object, uint8_t list);
+    // accounts for an allocation of size bytes, throws RuntimeError if it
+    // would exceed GcConfig::memory_limit
+    void Reserve(size_t size);
+    // true when the heap is close enough to its memory limit to be
+    // collected in full
+    bool UnderPressure() const;
+    void CollectPending();
+    bool IsMarked(const GcObject* object) const {
+        return object->list_ == grey_ || object->list_ == black_;
+    }
+    // greys a white object of this heap, with young_only only a young one
+    void Mark(GcObject* object, bool young_only = false);
+    void MarkRoots();
+    // traces grey objects until none is left or deadline has passed;
+    // true if none is left
+    bool Drain(bool young_only = false,
+               std::chrono::steady_clock::time_point deadline =
+                       std::chrono::steady_clock::time_point::max());
+    // the atomic end of a full collection
+    size_t FinishMarking();
+    // keeps the white objects of candidates referenced from outside the
+    // white objects and frees the rest
+    size_t Sweep(const std::vector<GcObject*>& candidates, bool young_only);
+
+    // marks an object of this heap for the background marker, true if it
+    // was not marked yet; called from both threads
+    bool Shade(GcObject* object) {
+        if (!object || object->heap_ != this){
+            return false;
+        }
+        auto mark = object->mark_.load(std::memory_order_acquire);
+        return mark != epoch_ && object->mark_.compare_exchange_strong(mark, epoch_);
+    }
+    void Remember(GcObject* object);
+    void StartConcurrentMarking();
+    // joins the marker and turns its marks into black and grey objects
+    void StopConcurrentMarking();
+    // body of the marker thread
+    void MarkConcurrently();
+};
+
+// makes heap current on this thread while the object exists
+class HeapScope{
+public:
+    explicit HeapScope(Heap* heap);
+    ~HeapScope();
+    HeapScope(const HeapScope&) = delete;
+    HeapScope& operator=(const HeapScope&) = delete;
+
+private:
+    Heap* previous_;
+};
+
+// deletes an object, kept until the background marker of its heap stops
+inline void GcDelete(GcObject* object) {
+    auto heap = object->GetHeap();
+    if (heap && heap->concurrent_){
+        heap->deferred_deletes_.push_back(object);
+    } else {
+        delete object;
+    }
+}
+
+// to be called before value replaces old in holder
+inline void GcWriteBarrier(GcObject* holder, GcObject* old, GcObject* value) {
+    if (auto heap = holder->GetHeap()){
+        heap->WriteBarrier(holder, old, value);
+    }
+}
+
+// runs a pending collection of the current heap
+inline void GcSafepoint() {
+    if (auto heap = Heap::Current()){
+        heap->Safepoint();
+    }
+}
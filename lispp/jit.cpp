@@ -0,0 +1,649 @@
+#include "jit.h"
+#include "resolver.h"
+#include "exceptions.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define LISPP_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+// state of one run of compiled code; machine code keeps only borrowed
+// words, values computed by the interpreter are owned by temps
+struct JitFrame {
+    JitFrame(JitCode* code, std::shared_ptr<Scope> scope, ValueType* temps) :
+            code(code), scope(std::move(scope)), temps(temps) {}
+
+    JitCode* code;
+    std::shared_ptr<Scope> scope;
+    ValueType* temps;
+    ASTNode* tail_node = nullptr;
+    std::exception_ptr error;
+};
+
+static thread_local TierState default_tier_state;
+static thread_local TierState* current_tier_state = &default_tier_state;
+
+TierThresholds& JitThresholds() {
+    return current_tier_state->thresholds;
+}
+
+TierStats& JitTierStats() {
+    return current_tier_state->stats;
+}
+
+TierScope::TierScope(TierState* state) : previous_(current_tier_state) {
+    current_tier_state = state;
+}
+
+TierScope::~TierScope() {
+    current_tier_state = previous_;
+}
+
+// Helpers called from machine code. They never throw: an exception is
+// stored in the frame and 0 is returned, the code then returns 0 at once.
+
+static uintptr_t JitEvalNode(JitFrame* frame, ASTNode* node, size_t temp) {
+    try {
+        frame->temps[temp] = node->ComputeValue(frame->scope);
+        return frame->temps[temp].Bits();
+    } catch (...) {
+        frame->error = std::current_exception();
+        return 0;
+    }
+}
+
+static uintptr_t JitUndefinedLocal(JitFrame* frame, ASTNode* node) {
+    try {
+        throw NameError("undefined name " + node->ToString());
+    } catch (...) {
+        frame->error = std::current_exception();
+        return 0;
+    }
+}
+
+// calls function, the value of the head of a call looked up before its
+// arguments were evaluated
+static uintptr_t JitCallValues(JitFrame* frame, const ValueType& function, size_t temp,
+                               const uintptr_t* args, size_t count) {
+    try {
+        if (function.GetType() != ValueType::ValueEnum::FUNC){
+            throw RuntimeError(function.ToString() + " is not self evaluating");
+        }
+        auto func = dynamic_cast<Func*>(function.AsNode());
+        if (!func){
+            throw RuntimeError(function.ToString() + " is not self evaluating");
+        }
+        std::vector<NodePtr> nodes;
+        for (size_t i = 0; i < count; ++i){
+            nodes.push_back(NodeFromArgument(ValueType::FromBits(args[i])));
+        }
+        frame->temps[temp] = func->Evaluate(ArgList(nodes), frame->scope);
+        return frame->temps[temp].Bits();
+    } catch (...) {
+        frame->error = std::current_exception();
+        return 0;
+    }
+}
+
+// gives a word loaded from a slot a reference of its own, so that a set!
+// of the local by a later operand does not free it while it is spilled
+static uintptr_t JitHold(JitFrame* frame, uintptr_t bits, size_t temp) {
+    frame->temps[temp] = ValueType::FromBits(bits);
+    return bits;
+}
+
+static uintptr_t JitBinary(JitFrame* frame, uintptr_t function, size_t temp,
+                           uintptr_t lhs, uintptr_t rhs) {
+    uintptr_t args[] = {lhs, rhs};
+    return JitCallValues(frame, ValueType::FromBits(function), temp, args, 2);
+}
+
+// rebinds the frame to the arguments of a tail call of the lambda itself
+// and returns its slots; the frame is reused unless a closure captured it.
+// This is the back edge of the loop, so it is also its safepoint.
+uintptr_t JitCode::SelfTail(JitFrame* frame, const uintptr_t* args) {
+    try {
+        auto lambda = frame->code->lambda_;
+        ++lambda->back_edge_count_;
+        ++JitTierStats().back_edges;
+        // the arguments may be borrowed from the slots they replace
+        const size_t kInlineArgs = 8;
+        ValueType inline_values[kInlineArgs];
+        std::vector<ValueType> more_values(lambda->arity_ > kInlineArgs ? lambda->arity_ : 0);
+        auto values = more_values.empty() ? inline_values : more_values.data();
+        for (size_t i = 0; i < lambda->arity_; ++i){
+            values[i] = ValueType::FromBits(args[i]);
+        }
+        // the arguments are held by values, the old ones by the frame
+        GcSafepoint();
+        if (frame->scope.use_count() != 1){
+            frame->scope = MakeScope(lambda->inner_scope_, lambda->frame_size_, lambda);
+        }
+        auto slots = frame->scope->Slots();
+        for (size_t i = 0; i < lambda->frame_size_; ++i){
+            // the frame may be an old one the marker is reading
+            slots[i].Store(i < lambda->arity_ ? std::move(values[i]) : ValueType());
+        }
+        return reinterpret_cast<uintptr_t>(slots);
+    } catch (...) {
+        frame->error = std::current_exception();
+        return 0;
+    }
+}
+
+static uintptr_t JitTail(JitFrame* frame, ASTNode* node) {
+    frame->tail_node = node;
+    return 0;
+}
+
+JitCode::JitCode(Lambda* lambda) : lambda_(lambda) {}
+
+JitCode::~JitCode() {
+#ifdef LISPP_JIT_X86_64
+    if (memory_){
+        munmap(memory_, memory_size_);
+    }
+#endif
+}
+
+ValueType JitCode::Run(std::shared_ptr<Scope> frame, TailCall* tail) {
+    if (valid_version_ != Scope::BindingVersion()){
+        valid_version_ = Scope::BindingVersion();
+        auto global = GlobalScope(lambda_->inner_scope_);
+        for (auto& guard : guards_){
+            auto binding = global->GetBinding(guard.first);
+            auto expected = guard.second ? guard.second.get() : lambda_;
+            if (!binding || binding->GetType() != ValueType::ValueEnum::FUNC ||
+                    binding->AsNode() != expected){
+                valid_version_ = 0;
+                break;
+            }
+        }
+    }
+    // the temps and spill area of most bodies fit on the native stack, so
+    // a call allocates nothing but its frame
+    const size_t kInlineTemps = 32;
+    const size_t kInlineSpill = 16;
+    if (temps_size_ <= kInlineTemps && spill_size_ <= kInlineSpill){
+        ValueType temps[kInlineTemps];
+        uintptr_t spill[kInlineSpill];
+        return Enter(std::move(frame), temps, spill, tail);
+    }
+    std::vector<ValueType> temps(temps_size_);
+    std::vector<uintptr_t> spill(spill_size_);
+    return Enter(std::move(frame), temps.data(), spill.data(), tail);
+}
+
+ValueType JitCode::Enter(std::shared_ptr<Scope> frame, ValueType* temps, uintptr_t* spill,
+                         TailCall* tail) {
+    JitFrame state(this, std::move(frame), temps);
+    auto bits = entry_(&state, state.scope->Slots(), spill);
+    if (state.error){
+        std::rethrow_exception(state.error);
+    }
+    if (state.tail_node){
+        *tail = {NodePtr(state.tail_node), std::move(state.scope)};
+        return ValueType();
+    }
+    return ValueType::FromBits(bits);
+}
+
+void JitCode::Trace(Tracer* tracer) {
+    for (auto& guard : guards_){
+        TraceNode(tracer, guard.second);
+    }
+    for (auto& constant : constants_){
+        TraceNode(tracer, constant);
+    }
+}
+
+#ifdef LISPP_JIT_X86_64
+
+namespace {
+
+// registers by their x86-64 encoding
+enum Reg : uint8_t {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R12 = 12, R13 = 13
+};
+
+enum Cond : uint8_t {
+    ALWAYS = 0, OVERFLOW = 0x80, EQUAL = 0x84, NOT_EQUAL = 0x85, LESS = 0x8C
+};
+
+class Assembler{
+public:
+    std::vector<uint8_t> code;
+
+    void Emit(std::initializer_list<uint8_t> bytes) {
+        code.insert(code.end(), bytes);
+    }
+
+    void Imm32(uint32_t value) {
+        for (int i = 0; i < 4; ++i){
+            code.push_back(value >> (8 * i));
+        }
+    }
+
+    void Imm64(uint64_t value) {
+        for (int i = 0; i < 8; ++i){
+            code.push_back(value >> (8 * i));
+        }
+    }
+
+    // mov reg, imm64
+    void MovImm(Reg reg, uint64_t value) {
+        Emit({static_cast<uint8_t>(0x48 | (reg >> 3)), static_cast<uint8_t>(0xB8 + (reg & 7))});
+        Imm64(value);
+    }
+
+    // mov dst, src
+    void Mov(Reg dst, Reg src) {
+        Emit({static_cast<uint8_t>(0x48 | ((src >> 3) << 2) | (dst >> 3)), 0x89,
+              static_cast<uint8_t>(0xC0 | ((src & 7) << 3) | (dst & 7))});
+    }
+
+    // mov reg, [base + disp], base is neither rsp nor r12
+    void Load(Reg reg, Reg base, int32_t disp) {
+        Emit({static_cast<uint8_t>(0x48 | ((reg >> 3) << 2) | (base >> 3)), 0x8B,
+              static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7))});
+        Imm32(disp);
+    }
+
+    // mov [base + disp], reg, base is neither rsp nor r12
+    void Store(Reg base, int32_t disp, Reg reg) {
+        Emit({static_cast<uint8_t>(0x48 | ((reg >> 3) << 2) | (base >> 3)), 0x89,
+              static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7))});
+        Imm32(disp);
+    }
+
+    // lea reg, [base + disp], base is neither rsp nor r12
+    void Lea(Reg reg, Reg base, int32_t disp) {
+        Emit({static_cast<uint8_t>(0x48 | ((reg >> 3) << 2) | (base >> 3)), 0x8D,
+              static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7))});
+        Imm32(disp);
+    }
+
+    void Call(const void* function) {
+        MovImm(RAX, reinterpret_cast<uint64_t>(function));
+        Emit({0xFF, 0xD0});
+    }
+
+    // jump with a 32-bit offset patched by Bind, returns its position
+    size_t Jump(Cond cond) {
+        if (cond == ALWAYS){
+            Emit({0xE9});
+        } else {
+            Emit({0x0F, cond});
+        }
+        Imm32(0);
+        return code.size();
+    }
+
+    void JumpTo(Cond cond, size_t target) {
+        auto from = Jump(cond);
+        Patch(from, target);
+    }
+
+    void Bind(size_t jump) {
+        Patch(jump, code.size());
+    }
+
+private:
+    void Patch(size_t jump, size_t target) {
+        uint32_t offset = static_cast<uint32_t>(static_cast<int64_t>(target) -
+                                                static_cast<int64_t>(jump));
+        std::memcpy(&code[jump - 4], &offset, 4);
+    }
+};
+
+const uintptr_t kFalseBits = ValueType(false).Bits();
+const uintptr_t kTrueBits = ValueType(true).Bits();
+
+}  // namespace
+
+// Translates a lambda body. Register use in the generated code:
+// r12 JitFrame*, rbx slots of the frame, r13 spill area holding operands
+// of pending calls; the result of every expression is left in rax.
+class JitCompiler{
+public:
+    explicit JitCompiler(Lambda* lambda) :
+            lambda_(lambda), code_(new JitCode(lambda)),
+            global_scope_(GlobalScope(lambda->inner_scope_)) {}
+
+    std::unique_ptr<JitCode> Compile() {
+        auto& body = dynamic_cast<FuncList*>(lambda_->func_.get())->Elements();
+        // push rbx; push r12; push r13, keeps the stack 16-byte aligned
+        as_.Emit({0x53, 0x41, 0x54, 0x41, 0x55});
+        as_.Mov(R12, RDI);
+        as_.Mov(RBX, RSI);
+        as_.Mov(R13, RDX);
+        start_ = as_.code.size();
+        for (size_t i = 0; i < body.size(); ++i){
+            CompileExpression(body[i].get(), i + 1 == body.size(), 0);
+        }
+        for (auto jump : exits_){
+            as_.Bind(jump);
+        }
+        // pop r13; pop r12; pop rbx; ret
+        as_.Emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+        if (!native_){
+            return nullptr;
+        }
+
+        auto size = as_.code.size();
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED){
+            return nullptr;
+        }
+        std::memcpy(memory, as_.code.data(), size);
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0){
+            munmap(memory, size);
+            return nullptr;
+        }
+        code_->memory_ = memory;
+        code_->memory_size_ = size;
+        code_->entry_ = reinterpret_cast<JitCode::Entry>(memory);
+        code_->spill_size_ = spill_size_;
+        return std::move(code_);
+    }
+
+private:
+    Lambda* lambda_;
+    std::unique_ptr<JitCode> code_;
+    std::shared_ptr<Scope> global_scope_;
+    Assembler as_;
+    size_t start_ = 0;
+    size_t spill_size_ = 0;
+    std::vector<size_t> exits_;
+    // whether anything besides calls into the interpreter was generated
+    bool native_ = false;
+
+    int32_t SpillOffset(size_t depth) {
+        spill_size_ = std::max(spill_size_, depth + 1);
+        return static_cast<int32_t>(depth * sizeof(uintptr_t));
+    }
+
+    size_t NewTemp() {
+        return code_->temps_size_++;
+    }
+
+    // returns 0 from the compiled code if rax is 0
+    void ExitIfZero() {
+        as_.Emit({0x48, 0x85, 0xC0});  // test rax, rax
+        exits_.push_back(as_.Jump(EQUAL));
+    }
+
+    void CallHelper(const void* helper, uint64_t arg1, uint64_t arg2) {
+        as_.Mov(RDI, R12);
+        as_.MovImm(RSI, arg1);
+        as_.MovImm(RDX, arg2);
+        as_.Call(helper);
+    }
+
+    // builtin bound to the head of call if it is one of the inlined ones
+    ASTNode* GlobalFunction(CallExpr* call) {
+        if (call->Function()->Type() != NodeType::VAR){
+            return nullptr;
+        }
+        auto name = static_cast<Var*>(call->Function().get())->GetSymbol();
+        auto binding = global_scope_->GetBinding(name);
+        if (!binding || binding->GetType() != ValueType::ValueEnum::FUNC){
+            return nullptr;
+        }
+        auto function = binding->AsNode();
+        // the code belongs to the lambda, a reference to it would be a cycle
+        code_->guards_.emplace_back(name, function == lambda_ ? NodePtr() : NodePtr(function));
+        return function;
+    }
+
+    void CompileExpression(ASTNode* node, bool tail, size_t depth) {
+        switch (node->Type()){
+            case NodeType::CONST: {
+                auto value = node->ComputeValue(nullptr);
+                as_.MovImm(RAX, value.Bits());
+                return;
+            }
+            case NodeType::LOCAL_VAR: {
+                auto var = static_cast<LocalVar*>(node);
+                if (var->Depth() == 0){
+                    CompileLocal(var);
+                    return;
+                }
+                break;
+            }
+            case NodeType::IF:
+                CompileIf(static_cast<IfExpr*>(node), tail, depth);
+                return;
+            case NodeType::CALL:
+                if (CompileCall(static_cast<CallExpr*>(node), tail, depth)){
+                    return;
+                }
+                break;
+            default:
+                break;
+        }
+        if (tail){
+            CallHelper(reinterpret_cast<const void*>(&JitTail), reinterpret_cast<uint64_t>(node), 0);
+            exits_.push_back(as_.Jump(ALWAYS));
+            return;
+        }
+        CallHelper(reinterpret_cast<const void*>(&JitEvalNode),
+                   reinterpret_cast<uint64_t>(node), NewTemp());
+        ExitIfZero();
+    }
+
+    void CompileLocal(LocalVar* var) {
+        as_.Load(RAX, RBX, static_cast<int32_t>(var->Index() * sizeof(ValueType)));
+        as_.Emit({0x48, 0x85, 0xC0});  // test rax, rax
+        auto bound = as_.Jump(NOT_EQUAL);
+        CallHelper(reinterpret_cast<const void*>(&JitUndefinedLocal),
+                   reinterpret_cast<uint64_t>(var), 0);
+        exits_.push_back(as_.Jump(ALWAYS));
+        as_.Bind(bound);
+    }
+
+    void CompileIf(IfExpr* node, bool tail, size_t depth) {
+        native_ = true;
+        CompileExpression(node->Test().get(), false, depth);
+        as_.MovImm(RCX, kFalseBits);
+        as_.Emit({0x48, 0x39, 0xC8});  // cmp rax, rcx
+        auto to_else = as_.Jump(EQUAL);
+        CompileExpression(node->Consequent().get(), tail, depth);
+        auto to_end = as_.Jump(ALWAYS);
+        as_.Bind(to_else);
+        if (node->Alternative()){
+            CompileExpression(node->Alternative().get(), tail, depth);
+        } else {
+            code_->constants_.push_back(NodePtr(new Empty()));
+            as_.MovImm(RAX, reinterpret_cast<uint64_t>(code_->constants_.back().get()));
+        }
+        as_.Bind(to_end);
+    }
+
+    // sets ZF if the guards of the fast paths hold, that is the binding
+    // version equals the one they were checked at
+    void CheckVersion() {
+        as_.MovImm(RDX, reinterpret_cast<uint64_t>(Scope::BindingVersionAddress()));
+        as_.Emit({0x48, 0x8B, 0x12});  // mov rdx, [rdx]
+        as_.MovImm(RSI, reinterpret_cast<uint64_t>(&code_->valid_version_));
+        as_.Emit({0x48, 0x3B, 0x16});  // cmp rdx, [rsi]
+    }
+
+    bool CompileCall(CallExpr* call, bool tail, size_t depth) {
+        auto function = GlobalFunction(call);
+        if (!function){
+            return false;
+        }
+        if (tail && function == lambda_ && call->Args().size() == lambda_->arity_){
+            CompileSelfTail(call, depth);
+            return true;
+        }
+        if (call->Args().size() != 2){
+            code_->guards_.pop_back();
+            return false;
+        }
+        if (dynamic_cast<Plus*>(function)){
+            CompileBinary(call, function, depth, [this] {
+                as_.Emit({0x48, 0x8D, 0x50, 0xFF});  // lea rdx, [rax - 1]
+                as_.Emit({0x48, 0x01, 0xCA});        // add rdx, rcx
+            });
+        } else if (dynamic_cast<Minus*>(function)){
+            CompileBinary(call, function, depth, [this] {
+                as_.Mov(RDX, RAX);
+                as_.Emit({0x48, 0x29, 0xCA});        // sub rdx, rcx
+            }, true);
+        } else if (dynamic_cast<Less*>(function)){
+            CompileCompare(call, function, depth, 0x4C);  // cmovl
+        } else if (dynamic_cast<Equal*>(function)){
+            CompileCompare(call, function, depth, 0x44);  // cmove
+        } else {
+            code_->guards_.pop_back();
+            return false;
+        }
+        return true;
+    }
+
+    // true if evaluating node cannot assign a local
+    static bool IsSimple(ASTNode* node) {
+        return node->Type() == NodeType::CONST || node->Type() == NodeType::LOCAL_VAR;
+    }
+
+    // makes the word in rax owned by a temp if one of later may be
+    // evaluated by the interpreter while the word is spilled
+    void HoldIfLaterRebind(ASTNode* node, const NodePtr* later, const NodePtr* end) {
+        if (node->Type() == NodeType::CONST || std::all_of(later, end, [](const NodePtr& arg) {
+                return IsSimple(arg.get());
+            })){
+            return;
+        }
+        as_.Mov(RDI, R12);
+        as_.Mov(RSI, RAX);
+        as_.MovImm(RDX, NewTemp());
+        as_.Call(reinterpret_cast<const void*>(&JitHold));
+    }
+
+    // spills the head of call at depth, looked up before the arguments as
+    // the interpreter does: the guarded builtin while the guards hold,
+    // otherwise the value the name is bound to, held by a temp
+    void CompileHead(CallExpr* call, ASTNode* function, size_t depth) {
+        CheckVersion();
+        auto lookup = as_.Jump(NOT_EQUAL);
+        as_.MovImm(RAX, reinterpret_cast<uint64_t>(function));
+        auto done = as_.Jump(ALWAYS);
+        as_.Bind(lookup);
+        CallHelper(reinterpret_cast<const void*>(&JitEvalNode),
+                   reinterpret_cast<uint64_t>(call->Function().get()), NewTemp());
+        ExitIfZero();
+        as_.Bind(done);
+        as_.Store(R13, SpillOffset(depth), RAX);
+    }
+
+    // evaluates the head and both arguments, leaves the arguments in rax
+    // and rcx and jumps to the returned slow path position unless the head
+    // is function and both are fixnums
+    std::vector<size_t> CompileOperands(CallExpr* call, ASTNode* function, size_t depth) {
+        native_ = true;
+        auto& args = call->Args();
+        CompileHead(call, function, depth);
+        CompileExpression(args[0].get(), false, depth + 1);
+        HoldIfLaterRebind(args[0].get(), &args[1], &args[1] + 1);
+        as_.Store(R13, SpillOffset(depth + 1), RAX);
+        CompileExpression(call->Args()[1].get(), false, depth + 2);
+        as_.Mov(RCX, RAX);
+        as_.Load(RAX, R13, SpillOffset(depth + 1));
+        std::vector<size_t> slow;
+        as_.Load(RDX, R13, SpillOffset(depth));
+        as_.MovImm(RSI, reinterpret_cast<uint64_t>(function));
+        as_.Emit({0x48, 0x39, 0xF2});  // cmp rdx, rsi
+        slow.push_back(as_.Jump(NOT_EQUAL));
+        as_.Emit({0xA8, 0x01});        // test al, 1
+        slow.push_back(as_.Jump(EQUAL));
+        as_.Emit({0xF6, 0xC1, 0x01});  // test cl, 1
+        slow.push_back(as_.Jump(EQUAL));
+        return slow;
+    }
+
+    // applies the head spilled at depth to rax and rcx
+    void CompileSlowBinary(size_t depth, std::vector<size_t> slow) {
+        for (auto jump : slow){
+            as_.Bind(jump);
+        }
+        as_.Mov(R8, RCX);
+        as_.Mov(RCX, RAX);
+        as_.Mov(RDI, R12);
+        as_.Load(RSI, R13, SpillOffset(depth));
+        as_.MovImm(RDX, NewTemp());
+        as_.Call(reinterpret_cast<const void*>(&JitBinary));
+        ExitIfZero();
+    }
+
+    template <class Op>
+    void CompileBinary(CallExpr* call, ASTNode* function, size_t depth, Op op,
+                       bool retag = false) {
+        auto slow = CompileOperands(call, function, depth);
+        op();
+        slow.push_back(as_.Jump(OVERFLOW));
+        if (retag){
+            as_.Emit({0x48, 0x83, 0xCA, 0x01});  // or rdx, 1
+        }
+        as_.Mov(RAX, RDX);
+        auto done = as_.Jump(ALWAYS);
+        CompileSlowBinary(depth, std::move(slow));
+        as_.Bind(done);
+    }
+
+    void CompileCompare(CallExpr* call, ASTNode* function, size_t depth, uint8_t cmov) {
+        auto slow = CompileOperands(call, function, depth);
+        as_.Emit({0x48, 0x39, 0xC8});  // cmp rax, rcx
+        as_.MovImm(RAX, kFalseBits);
+        as_.MovImm(RDX, kTrueBits);
+        as_.Emit({0x48, 0x0F, cmov, 0xC2});  // cmovcc rax, rdx
+        auto done = as_.Jump(ALWAYS);
+        CompileSlowBinary(depth, std::move(slow));
+        as_.Bind(done);
+    }
+
+    void CompileSelfTail(CallExpr* call, size_t depth) {
+        native_ = true;
+        // with a stale guard the interpreter performs the tail call
+        CheckVersion();
+        auto checked = as_.Jump(EQUAL);
+        CallHelper(reinterpret_cast<const void*>(&JitTail), reinterpret_cast<uint64_t>(call), 0);
+        exits_.push_back(as_.Jump(ALWAYS));
+        as_.Bind(checked);
+
+        auto& args = call->Args();
+        for (size_t i = 0; i < args.size(); ++i){
+            CompileExpression(args[i].get(), false, depth + i);
+            HoldIfLaterRebind(args[i].get(), args.data() + i + 1, args.data() + args.size());
+            as_.Store(R13, SpillOffset(depth + i), RAX);
+        }
+        SpillOffset(depth + args.size());
+        // the head was looked up before the arguments, as the interpreter
+        // does, so the call is a loop even if they rebound the name
+        as_.Mov(RDI, R12);
+        as_.Lea(RSI, R13, SpillOffset(depth));
+        as_.Call(reinterpret_cast<const void*>(&JitCode::SelfTail));
+        ExitIfZero();
+        as_.Mov(RBX, RAX);
+        as_.JumpTo(ALWAYS, start_);
+    }
+};
+
+std::unique_ptr<JitCode> JitCompile(Lambda* lambda) {
+    return JitCompiler(lambda).Compile();
+}
+
+#else
+
+std::unique_ptr<JitCode> JitCompile(Lambda*) {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "node_types.h"
+
+// Template JIT for hot Lambda bodies on x86-64. Constants, parameters of
+// the lambda, if, calls of the builtins + - < = with two fixnums and tail
+// calls of the lambda to itself are translated to machine code; every
+// other expression is evaluated by the interpreter from the machine code,
+// and in tail position it is handed back to RunTailCalls. The fast paths
+// are guarded by the global binding version, so redefining + or the
+// lambda's own name switches them to the interpreter.
+
+constexpr size_t kJitCallThreshold = 1000;
+constexpr size_t kJitBackEdgeThreshold = 1000;
+
+// A Lambda starts in the tree walker and is promoted to machine code once
+// its calls or its back edges, calls of the lambda from its own body,
+// reach a threshold. Thresholds and counters belong to the interpreter
+// running on the thread, see TierScope; (tier-stats) reports them.
+struct TierThresholds {
+    size_t calls = kJitCallThreshold;
+    size_t back_edges = kJitBackEdgeThreshold;
+};
+
+struct TierStats {
+    size_t interpreted_calls = 0;
+    size_t compiled_calls = 0;
+    size_t back_edges = 0;
+    size_t promotions = 0;
+    // promoted lambdas with nothing to compile, they stay interpreted
+    size_t failed_promotions = 0;
+};
+
+struct TierState {
+    TierThresholds thresholds;
+    TierStats stats;
+};
+
+// thresholds and counters of the current state, a per-thread default one
+// when no TierScope is active
+TierThresholds& JitThresholds();
+
+TierStats& JitTierStats();
+
+// makes state current on this thread while the object exists
+class TierScope{
+public:
+    explicit TierScope(TierState* state);
+    ~TierScope();
+    TierScope(const TierScope&) = delete;
+    TierScope& operator=(const TierScope&) = delete;
+
+private:
+    TierState* previous_;
+};
+
+struct JitFrame;
+
+class JitCode{
+public:
+    ~JitCode();
+    // runs the body in frame, which holds the bound arguments
+    ValueType Run(std::shared_ptr<Scope> frame, TailCall* tail);
+    void Trace(Tracer* tracer);
+
+private:
+    friend class JitCompiler;
+
+    using Entry = uintptr_t (*)(JitFrame* frame, ValueType* slots, uintptr_t* spill);
+
+    Lambda* lambda_;
+    void* memory_ = nullptr;
+    size_t memory_size_ = 0;
+    Entry entry_ = nullptr;
+    // builtins bound to the names the fast paths use, null for the lambda
+    // itself; the references keep a builtin whose name was rebound from
+    // being freed and its memory reused by another node
+    std::vector<std::pair<Symbol, NodePtr>> guards_;
+    // binding version the guards were checked at, 0 if they do not hold
+    uint64_t valid_version_ = 0;
+    std::vector<NodePtr> constants_;
+    size_t temps_size_ = 0;
+    size_t spill_size_ = 0;
+
+    explicit JitCode(Lambda* lambda);
+    // runs the machine code with temps_size_ temps and spill_size_ words
+    ValueType Enter(std::shared_ptr<Scope> frame, ValueType* temps, uintptr_t* spill,
+                    TailCall* tail);
+    static uintptr_t SelfTail(JitFrame* frame, const uintptr_t* args);
+};
+
+// machine code for the body of lambda, null if the platform is not
+// supported or the body has nothing to compile
+std::unique_ptr<JitCode> JitCompile(Lambda* lambda);
@@ -1,68 +1,76 @@
 #include "lispp.h"
 
-Lispp::Lispp() : in_(&std::cin), out_(&std::cout) {}
+Handle::Handle(Heap* heap, ValueType value) : heap_(heap), value_(std::move(value)) {
+    roots_ = heap_->AddRoots([this](Tracer* tracer) {
+        TraceValue(tracer, value_);
+    });
+}
+
+Handle::~Handle() {
+    heap_->RemoveRoots(roots_);
+}
+
+const ValueType& Handle::Get() const {
+    return value_;
+}
+
+Lispp::Lispp() : heap_(new Heap()), mode_(EvalMode::BYTECODE), in_(&std::cin), out_(&std::cout) {}
 
 Lispp::~Lispp() {
-    for (auto it = global_scope_->table_->begin(); it != global_scope_->table_->end(); ++it){
-        if (it->second.GetType() == ValueType::ValueEnum::FUNC){
-            auto node = it->second.GetValue<NodePtr>();
-            if (node->Type() == NodeType::LAMBDA){
-                dynamic_cast<Lambda*>(node.get())->inner_scope_.reset();
-            }
-        }
+    HeapScope heap_scope(heap_.get());
+    // the default constructor adds no root set, roots_ may be the id of a Handle's
+    if (global_scope_){
+        heap_->RemoveRoots(roots_);
     }
+    folder_.reset();
+    closure_compiler_.reset();
+    global_scope_.reset();
+    heap_->Collect();
 }
 
-Lispp::Lispp(std::istream *in, std::ostream *out) :
-        in_(in), out_(out) {
+Lispp::Lispp(std::istream *in, std::ostream *out, EvalMode mode, GcConfig gc_config,
+             TierThresholds tier_thresholds) :
+        heap_(new Heap(gc_config)), mode_(mode), in_(in), out_(out) {
+    HeapScope heap_scope(heap_.get());
+    tier_state_.thresholds = tier_thresholds;
     tokenizer_ = std::make_shared<Tokenizer>(in_);
     parser_ = std::make_shared<Parser>(tokenizer_);
-    global_scope_ = std::make_shared<Scope>();
-    global_scope_->AddName("define", ValueType(NodePtr(new Define())));
-    global_scope_->AddName("lambda", ValueType(NodePtr(new LambdaForm())));
-    global_scope_->AddName("+", ValueType(NodePtr(new Plus())));
-    global_scope_->AddName("-", ValueType(NodePtr(new Minus())));
-    global_scope_->AddName("*", ValueType(NodePtr(new Mult())));
-    global_scope_->AddName("/", ValueType(NodePtr(new Div())));
-    global_scope_->AddName("set!", ValueType(NodePtr(new Set())));
-    global_scope_->AddName("if", ValueType(NodePtr(new IfElse())));
-    global_scope_->AddName("quote", ValueType(NodePtr(new QuoteForm())));
-    global_scope_->AddName("and", ValueType(NodePtr(new And())));
-    global_scope_->AddName("or", ValueType(NodePtr(new Or())));
-    global_scope_->AddName("null?", ValueType(NodePtr(new NullPredicate())));
-    global_scope_->AddName("pair?", ValueType(NodePtr(new PairPredicate())));
-    global_scope_->AddName("number?", ValueType(NodePtr(new NumberPredicate())));
-    global_scope_->AddName("boolean?", ValueType(NodePtr(new BoolPredicate())));
-    global_scope_->AddName("symbol?", ValueType(NodePtr(new SymbolPredicate())));
-    global_scope_->AddName("list?", ValueType(NodePtr(new ListPredicate())));
-    global_scope_->AddName("eq?", ValueType(NodePtr(new EqPredicate())));
-    global_scope_->AddName("equal?", ValueType(NodePtr(new EqualPredicate())));
-    global_scope_->AddName("integer-equal?", ValueType(NodePtr(new IntEqualPredicate())));
-    global_scope_->AddName("not", ValueType(NodePtr(new Not())));
-    global_scope_->AddName("=", ValueType(NodePtr(new Equal())));
-    global_scope_->AddName("<", ValueType(NodePtr(new Less())));
-    global_scope_->AddName(">", ValueType(NodePtr(new More())));
-    global_scope_->AddName("<=", ValueType(NodePtr(new LessEqual())));
-    global_scope_->AddName(">=", ValueType(NodePtr(new MoreEqual())));
-    global_scope_->AddName("min", ValueType(NodePtr(new Min())));
-    global_scope_->AddName("max", ValueType(NodePtr(new Max())));
-    global_scope_->AddName("abs", ValueType(NodePtr(new Abs())));
-    global_scope_->AddName("cons", ValueType(NodePtr(new Cons())));
-    global_scope_->AddName("car", ValueType(NodePtr(new Car())));
-    global_scope_->AddName("cdr", ValueType(NodePtr(new Cdr())));
-    global_scope_->AddName("set-car!", ValueType(NodePtr(new SetCar())));
-    global_scope_->AddName("set-cdr!", ValueType(NodePtr(new SetCdr())));
-    global_scope_->AddName("list", ValueType(NodePtr(new ListForm())));
-    global_scope_->AddName("list-ref", ValueType(NodePtr(new ListRef())));
-    global_scope_->AddName("list-tail", ValueType(NodePtr(new ListTail())));
-    global_scope_->AddName("eval", ValueType(NodePtr(new Eval())));
+    global_scope_ = MakeScope();
+    AddBuiltins(global_scope_.get());
+    folder_.reset(new ConstantFolder(global_scope_));
+    closure_compiler_.reset(new ClosureCompiler(global_scope_));
+    roots_ = heap_->AddRoots([this](Tracer* tracer) {
+        TraceScope(tracer, global_scope_);
+        vm_.TraceRoots(tracer);
+        cek_.TraceRoots(tracer);
+    });
 }
 
 void Lispp::Run() {
-    auto node = parser_->Parse();
-    ValueType value = node->ComputeValue(global_scope_);
+    HeapScope heap_scope(heap_.get());
+    TierScope tier_scope(&tier_state_);
+    auto node = folder_->Fold(resolver_.Resolve(parser_->Parse()));
+    ValueType value;
+    if (mode_ == EvalMode::TREE_WALK) {
+        value = node->ComputeValue(global_scope_);
+    } else if (mode_ == EvalMode::CEK) {
+        value = cek_.Run(node, global_scope_);
+    } else if (mode_ == EvalMode::CLOSURE) {
+        value = closure_compiler_->Compile(node)(global_scope_, nullptr);
+    } else {
+        value = vm_.Run(compiler_.Compile(node), global_scope_);
+    }
     auto value_string = value.ToString();
     if (value_string != "") {
         (*out_) << "     >> " << value.ToString() << std::endl;
     };
-}
\ No newline at end of file
+    heap_->Safepoint();
+}
+
+Heap* Lispp::GetHeap() const {
+    return heap_.get();
+}
+
+HeapStats Lispp::HeapStats() const {
+    return MeasureHeap(*heap_);
+}
@@ -2,19 +2,69 @@
 
 #include "tokenizer.h"
 #include "parser.h"
+#include "vm.h"
+#include "folder.h"
+#include "closure_compiler.h"
+#include "cek.h"
+#include "gc.h"
+#include "jit.h"
 #include <memory>
 #include <iostream>
 
+// TREE_WALK evaluates the AST, BYTECODE runs it compiled for VM, CLOSURE
+// runs it compiled by ClosureCompiler, CEK evaluates it with CekMachine
+enum class EvalMode {
+    TREE_WALK, BYTECODE, CLOSURE, CEK
+};
+
+// value kept by an embedder, a root of the heap while the handle exists
+class Handle{
+public:
+    Handle(Heap* heap, ValueType value);
+    ~Handle();
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+    const ValueType& Get() const;
+
+private:
+    Heap* heap_;
+    ValueType value_;
+    size_t roots_;
+};
+
+// Interpreters are independent and may run on different threads, but one
+// interpreter is used by one thread at a time. The heap, the JIT tier
+// thresholds and counters are per interpreter and made current by Run. The
+// symbol table is shared by the process and locked, its names live until
+// exit; the global binding version is a shared atomic counter, a rebinding
+// in one interpreter only makes the others recheck their guards.
 class Lispp{
 public:
     Lispp();
-    Lispp(std::istream* in, std::ostream* out);
+    Lispp(std::istream* in, std::ostream* out, EvalMode mode = EvalMode::BYTECODE,
+          GcConfig gc_config = GcConfig(), TierThresholds tier_thresholds = TierThresholds());
+    // drops the roots and collects, which frees the cycles between the
+    // global scope and the closures defined in it
     ~Lispp();
     void Run();
+    // heap of the objects made by this interpreter
+    Heap* GetHeap() const;
+    // what (heap-stats) reports
+    ::HeapStats HeapStats() const;
 private:
+    std::unique_ptr<Heap> heap_;
+    size_t roots_ = 0;
     std::shared_ptr<Tokenizer> tokenizer_;
     std::shared_ptr<Parser> parser_;
     std::shared_ptr<Scope> global_scope_;
+    TierState tier_state_;
+    EvalMode mode_;
+    Resolver resolver_;
+    std::unique_ptr<ConstantFolder> folder_;
+    Compiler compiler_;
+    std::unique_ptr<ClosureCompiler> closure_compiler_;
+    VM vm_;
+    CekMachine cek_;
     std::istream* in_;
     std::ostream* out_;
 };
@@ -1,6 +1,9 @@
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <cstring>
 #include "lispp.h"
+#include "cpp_emitter.h"
 
 void NextInput(std::stringstream *ss){
     std::cout << "Lispp>> ";
@@ -13,7 +16,37 @@ void NextInput(std::stringstream *ss){
         ss->str(old_input + new_input);
 }
 
-int main() {
+// lispp --compile file.lisp -o out.cpp
+int Compile(int argc, char** argv) {
+    if (argc != 5 || std::strcmp(argv[3], "-o") != 0){
+        std::cerr << "usage: lispp --compile file.lisp -o out.cpp" << std::endl;
+        return 2;
+    }
+    std::ifstream in(argv[2]);
+    if (!in){
+        std::cerr << "can not open " << argv[2] << std::endl;
+        return 1;
+    }
+    std::string source;
+    try {
+        source = CompileToCpp(&in);
+    } catch (const std::exception& exception){
+        std::cerr << argv[2] << ": " << exception.what() << std::endl;
+        return 1;
+    }
+    std::ofstream out(argv[4]);
+    out << source;
+    if (!out){
+        std::cerr << "can not write " << argv[4] << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--compile") == 0){
+        return Compile(argc, argv);
+    }
     std::stringstream in;
     Lispp lispp(&in, &std::cout);
     std::cout << "Lispp prompt\nFor exit press Ctrl+D\n\n";
@@ -1,5 +1,7 @@
 #include "node_types.h"
+#include "jit.h"
 #include "exceptions.h"
+#include "resolver.h"
 #include <algorithm>
 
 NodeType Empty::Type() const {
@@ -10,7 +12,7 @@ std::string Empty::ToString() const {
     return "()";
 }
 
-ValueType Empty::ComputeValue(std::shared_ptr<Scope> scope) {
+ValueType Empty::ComputeValue(const std::shared_ptr<Scope>& /*scope*/) {
     throw RuntimeError("() is not self evaluating");
 }
 
@@ -20,7 +22,7 @@ NodeType Const::Type() const {
     return NodeType ::CONST;
 }
 
-ValueType Const::ComputeValue(std::shared_ptr<Scope> scope) {
+ValueType Const::ComputeValue(const std::shared_ptr<Scope>& /*scope*/) {
     return value_;
 }
 
@@ -28,36 +30,112 @@ std::string Const::ToString() const {
     return value_.ToString();
 }
 
-Var::Var(const std::string& name) : name_(name){}
+void Const::Trace(Tracer* tracer) {
+    TraceValue(tracer, value_);
+}
+
+void Const::ClearReferences() {
+    value_.Clear();
+}
+
+Var::Var(Symbol name) : name_(name){}
+
+Var::Var(const std::string& name) : name_(Symbol::Intern(name)){}
 
 NodeType Var::Type() const {
     return NodeType ::VAR;
 }
 
-ValueType Var::ComputeValue(std::shared_ptr<Scope> scope) {
+ValueType Var::ComputeValue(const std::shared_ptr<Scope>& scope) {
     return scope->GetValue(name_);
 }
 
 std::string Var::ToString() const {
+    return name_.Name();
+}
+
+Symbol Var::GetSymbol() const {
     return name_;
 }
 
+LocalVar::LocalVar(Symbol name, size_t depth, size_t index) :
+        name_(name), depth_(depth), index_(index) {}
+
+NodeType LocalVar::Type() const {
+    return NodeType ::LOCAL_VAR;
+}
+
+ValueType LocalVar::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    auto& value = scope->Slot(depth_, index_);
+    if (value.GetType() == ValueType::ValueEnum::UNDEFINED){
+        throw NameError("undefined name " + name_.Name());
+    }
+    return value;
+}
+
+std::string LocalVar::ToString() const {
+    return name_.Name();
+}
+
+void LocalVar::Define(const std::shared_ptr<Scope>& scope, const ValueType& value) {
+    scope->StoreSlot(depth_, index_, value);
+}
+
+void LocalVar::SetValue(const std::shared_ptr<Scope>& scope, const ValueType& value) {
+    if (scope->Slot(depth_, index_).GetType() == ValueType::ValueEnum::UNDEFINED){
+        throw NameError("undefined name " + name_.Name());
+    }
+    scope->StoreSlot(depth_, index_, value);
+}
+
+size_t LocalVar::Depth() const {
+    return depth_;
+}
+
+size_t LocalVar::Index() const {
+    return index_;
+}
+
 Quote::Quote(NodePtr value) : value_(std::move(value)) {}
 
 NodeType Quote::Type() const {
     return NodeType ::QUOTE;
 }
 
-ValueType Quote::ComputeValue(std::shared_ptr<Scope> scope) {
-    return ValueType(value_);
+ValueType Quote::ComputeValue(const std::shared_ptr<Scope>& /*scope*/) {
+    return ValueFromNode(value_);
 }
 
 std::string Quote::ToString() const {
     return "'" + value_->ToString();
 }
 
-Pair::Pair(NodePtr first, NodePtr second) :
-        car_(std::move(first)), cdr_(std::move(second)){}
+void Quote::Trace(Tracer* tracer) {
+    TraceNode(tracer, value_);
+}
+
+void Quote::ClearReferences() {
+    value_.reset();
+}
+
+Pair::Pair(ValueType car, ValueType cdr) : car_(std::move(car)), cdr_(std::move(cdr)) {}
+
+static ValueType CellValue(const NodePtr& node) {
+    return node ? ValueFromNode(node) : ValueType();
+}
+
+Pair::Pair(const NodePtr& first, const NodePtr& second) :
+        car_(CellValue(first)), cdr_(CellValue(second)) {}
+
+Pair::~Pair() {
+    LeaveRun();
+    // a long list is released in a loop instead of recursing through cdr_
+    auto next = cdr_.Take();
+    for (auto pair = AsPair(next); pair && IsUniqueNode(pair); pair = AsPair(next)){
+        auto rest = pair->cdr_.Take();
+        next = std::move(rest);
+    }
+}
 
 NodeType Pair::Type() const {
     return NodeType ::PAIR;
@@ -65,81 +143,194 @@ NodeType Pair::Type() const {
 
 std::string Pair::ToString() const {
     std::string result("(");
-    auto elements = ToVector();
+    auto elements = ToValues();
     auto last = elements.end();
     --last;
     for (auto el = elements.begin(); el != last; ++el){
-        result += (*el)->ToString();
+        result += el->ToString();
         result += " ";
     }
-    if ((*last)->Type() == NodeType::EMPTY){
+    if (IsNull(*last)){
         result.pop_back();
     } else {
         result += ". ";
-        result += (*last)->ToString();
+        result += last->ToString();
     }
     result += ")";
     return result;
 }
 
-std::vector<NodePtr> Pair::ToReverseVector() const {
-    std::vector<NodePtr> res;
-    if (cdr_->Type() == NodeType::PAIR){
-        res = dynamic_cast<Pair *>(cdr_.get())->ToReverseVector();
-    } else {
-        res.push_back(cdr_);
+std::vector<ValueType> Pair::ToValues() const {
+    std::vector<ValueType> values;
+    auto pair = this;
+    values.push_back(pair->car_);
+    while (auto next = AsPair(pair->cdr_)){
+        pair = next;
+        values.push_back(pair->car_);
     }
-    res.push_back(car_);
-    return res;
+    values.push_back(pair->cdr_);
+    return values;
 }
 
 std::vector<NodePtr> Pair::ToVector() const {
-    auto res = ToReverseVector();
-    std::reverse(std::begin(res), std::end(res));
-    return res;
+    std::vector<NodePtr> nodes;
+    for (auto& value : ToValues()){
+        nodes.push_back(NodeFromValue(value));
+    }
+    return nodes;
 }
 
 NodePtr Pair::Car() const {
-    return car_;
+    return NodeFromValue(car_);
 }
 
 NodePtr Pair::Cdr() const {
+    return NodeFromValue(cdr_);
+}
+
+const ValueType& Pair::CarValue() const {
+    return car_;
+}
+
+const ValueType& Pair::CdrValue() const {
     return cdr_;
 }
 
-void Pair::SetCar(NodePtr car) {
-    car_ = car;
+void Pair::SetCar(ValueType car) {
+    GcWriteBarrier(this, car_, car);
+    car_.Store(std::move(car));
+}
+
+void Pair::SetCdr(ValueType cdr) {
+    if (auto ahead = RunAhead()){
+        // the pairs after this one still follow each other, so they go on
+        // as a run of their own
+        auto& pairs = run_->pairs;
+        auto begin = pairs.begin() + run_index_ + 1;
+        if (ahead > 1){
+            auto rest = new PairRun{0, GcVector<Pair*>(begin, pairs.end())};
+            for (size_t i = 0; i < ahead; ++i){
+                rest->pairs[i]->JoinRun(rest, i);
+            }
+        } else {
+            (*begin)->LeaveRun();
+        }
+        pairs.erase(begin, pairs.end());
+    }
+    GcWriteBarrier(this, cdr_, cdr);
+    cdr_.Store(std::move(cdr));
+}
+
+Pair* Pair::Tail(size_t count) {
+    auto pair = this;
+    while (count > 0){
+        if (auto ahead = pair->RunAhead()){
+            auto step = std::min(count, ahead);
+            pair = pair->run_->pairs[pair->run_index_ + step];
+            count -= step;
+        } else {
+            pair = AsPair(pair->cdr_);
+            if (!pair){
+                return nullptr;
+            }
+            --count;
+        }
+    }
+    return pair;
 }
 
-void Pair::SetCdr(NodePtr cdr) {
-    cdr_ = cdr;
+Pair* Pair::Last() {
+    auto pair = this;
+    while (true){
+        if (auto ahead = pair->RunAhead()){
+            pair = pair->run_->pairs[pair->run_index_ + ahead];
+        } else if (auto next = AsPair(pair->cdr_)){
+            pair = next;
+        } else {
+            return pair;
+        }
+    }
 }
 
-ValueType Pair::ComputeValue(std::shared_ptr<Scope> scope) {
+void Pair::JoinRun(PairRun* run, size_t index) {
+    ++run->ref_count;
+    LeaveRun();
+    run_ = run;
+    run_index_ = index;
+}
 
-    auto func = car_->ComputeValue(scope);
-    if (func.GetType() != ValueType::ValueEnum::FUNC) {
-        throw RuntimeError(func.ToString() + " is not self evaluating");
+void Pair::LeaveRun() {
+    if (run_ && --run_->ref_count == 0){
+        delete run_;
     }
+    run_ = nullptr;
+}
+
+size_t Pair::RunAhead() const {
+    return run_ ? run_->pairs.size() - 1 - run_index_ : 0;
+}
+
+void Pair::Trace(Tracer* tracer) {
+    TraceValue(tracer, car_);
+    TraceValue(tracer, cdr_);
+}
+
+void Pair::ClearReferences() {
+    car_.Clear();
+    cdr_.Clear();
+}
+
+ValueType Pair::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    return RunTailCalls(this, scope);
+}
+
+// applies the value of a call's head to its arguments
+static ValueType ApplyFunction(const ValueType& function, const ArgList& args,
+                               const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    if (function.GetType() != ValueType::ValueEnum::FUNC) {
+        throw RuntimeError(function.ToString() + " is not self evaluating");
+    }
+    auto node = function.AsNode();
+    if (auto tail_func = dynamic_cast<TailFunc*>(node)){
+        return tail_func->EvaluateTail(args, scope, tail);
+    }
+    if (auto func = dynamic_cast<Func*>(node)){
+        return func->Evaluate(args, scope);
+    }
+    throw RuntimeError(node->ToString() + " is not self evaluating");
+}
 
+ValueType Pair::EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    auto function = Car()->ComputeValue(scope);
     std::vector<NodePtr> args;
-    if (cdr_->Type() == NodeType::PAIR) {
-        args = dynamic_cast<Pair *>(cdr_.get())->ToVector();
+    if (auto rest = AsPair(cdr_)) {
+        args = rest->ToVector();
     } else {
-        args.push_back(cdr_);
+        args.push_back(Cdr());
     }
     if (args.back()->Type() != NodeType::EMPTY) {
         throw SyntaxError("dotted pair is not self evaluating");
     }
     args.pop_back();
-    return dynamic_cast<Func*>(func.GetValue<NodePtr>().get())->Evaluate(args, scope);
+    return ApplyFunction(function, ArgList(args), scope, tail);
+}
+
+ValueType RunTailCalls(ASTNode* node, const std::shared_ptr<Scope>& scope) {
+    TailCall tail;
+    auto value = node->EvaluateTail(scope, &tail);
+    while (tail.node){
+        TailCall next;
+        value = tail.node->EvaluateTail(tail.scope, &next);
+        tail = std::move(next);
+    }
+    return value;
 }
 
 NodeType Func::Type() const {
     return NodeType ::FUNC;
 }
 
-ValueType Func::ComputeValue(std::shared_ptr<Scope> scope) {
+ValueType Func::ComputeValue(const std::shared_ptr<Scope>& /*scope*/) {
     throw SyntaxError("function is not self evaluating");
 }
 
@@ -147,6 +338,65 @@ std::string Func::ToString() const {
     return "function";
 }
 
+Func* Func::AsFunc() {
+    return this;
+}
+
+bool Func::IsClosure() const {
+    return Type() == NodeType::LAMBDA;
+}
+
+size_t Func::CallCount() const {
+    return 0;
+}
+
+size_t Func::BackEdgeCount() const {
+    return 0;
+}
+
+ValueType Func::Call(ArgSpan args, const std::shared_ptr<Scope>& scope, ClosureTail* /*tail*/) {
+    std::vector<NodePtr> nodes;
+    nodes.reserve(args.size());
+    for (auto& arg : args){
+        nodes.push_back(NodeFromArgument(arg));
+    }
+    return Evaluate(ArgList(nodes), scope);
+}
+
+ValueType Primitive::Evaluate(const ArgList& args,
+                              const std::shared_ptr<Scope>& scope) {
+    const size_t kInlineArgs = 8;
+    if (args.size() <= kInlineArgs){
+        ValueType values[kInlineArgs];
+        size_t i = 0;
+        for (auto& arg : args){
+            values[i++] = arg->ComputeValue(scope);
+        }
+        return Apply(ArgSpan(values, i));
+    }
+    std::vector<ValueType> values;
+    values.reserve(args.size());
+    for (auto& arg : args){
+        values.push_back(arg->ComputeValue(scope));
+    }
+    return Apply(ArgSpan(values.data(), values.size()));
+}
+
+ValueType Primitive::Call(ArgSpan args, const std::shared_ptr<Scope>& /*scope*/,
+                          ClosureTail* /*tail*/) {
+    return Apply(args);
+}
+
+ValueType TailFunc::Evaluate(const ArgList& args,
+                             const std::shared_ptr<Scope>& scope) {
+    TailCall tail;
+    auto value = EvaluateTail(args, scope, &tail);
+    if (!tail.node){
+        return value;
+    }
+    return RunTailCalls(tail.node.get(), tail.scope);
+}
+
 FuncList::FuncList(const std::vector<NodePtr> &func_list) :
         func_list_(func_list) {}
 
@@ -164,7 +414,21 @@ std::string FuncList::ToString() const {
     return result;
 }
 
-ValueType FuncList::ComputeValue(std::shared_ptr<Scope> scope) {
+void FuncList::Trace(Tracer* tracer) {
+    for (auto& func : func_list_){
+        TraceNode(tracer, func);
+    }
+}
+
+void FuncList::ClearReferences() {
+    func_list_.clear();
+}
+
+const std::vector<NodePtr>& FuncList::Elements() const {
+    return func_list_;
+}
+
+ValueType FuncList::ComputeValue(const std::shared_ptr<Scope>& scope) {
     auto last = func_list_.end();
     --last;
     for (auto el = func_list_.begin(); el != last; ++el){
@@ -173,90 +437,452 @@ ValueType FuncList::ComputeValue(std::shared_ptr<Scope> scope) {
     return (*last)->ComputeValue(scope);
 }
 
-Lambda::Lambda(std::vector<std::string> vars,
-               NodePtr func,
+LambdaExpr::LambdaExpr(std::vector<Symbol> names, size_t arity, NodePtr body) :
+        names_(std::move(names)), arity_(arity), body_(std::move(body)) {}
+
+NodeType LambdaExpr::Type() const {
+    return NodeType ::LAMBDA_EXPR;
+}
+
+ValueType LambdaExpr::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    return ValueType(NodePtr(new Lambda(arity_, names_.size(), body_, scope)));
+}
+
+std::string LambdaExpr::ToString() const {
+    return "lambda";
+}
+
+void LambdaExpr::Trace(Tracer* tracer) {
+    TraceNode(tracer, body_);
+}
+
+void LambdaExpr::ClearReferences() {
+    body_.reset();
+}
+
+const std::vector<Symbol>& LambdaExpr::Names() const {
+    return names_;
+}
+
+size_t LambdaExpr::Arity() const {
+    return arity_;
+}
+
+size_t LambdaExpr::FrameSize() const {
+    return names_.size();
+}
+
+const FuncList& LambdaExpr::Body() const {
+    return *dynamic_cast<FuncList*>(body_.get());
+}
+
+Lambda::Lambda(size_t arity, size_t frame_size, NodePtr func,
                std::shared_ptr<Scope> inner_scope)  :
-        vars_(std::move(vars)), func_(std::move(func)), inner_scope_(std::move(inner_scope)){}
+        arity_(arity), frame_size_(frame_size), func_(std::move(func)),
+        inner_scope_(std::move(inner_scope)){}
+
+Lambda::~Lambda() {
+    delete jit_code_.load(std::memory_order_relaxed);
+}
+
+void Lambda::Trace(Tracer* tracer) {
+    TraceNode(tracer, func_);
+    TraceScope(tracer, inner_scope_);
+    if (auto code = jit_code_.load(std::memory_order_acquire)){
+        code->Trace(tracer);
+    }
+}
+
+void Lambda::ClearReferences() {
+    func_.reset();
+    inner_scope_.reset();
+    delete jit_code_.exchange(nullptr);
+}
 
 NodeType Lambda::Type() const {
     return NodeType ::LAMBDA;
 }
 
-ValueType Lambda::Evaluate(std::vector<NodePtr> args,
-                           std::shared_ptr<Scope> scope) {
-    auto full_scope = ConcatScopes(inner_scope_, scope);
-    auto new_scope = std::make_shared<Scope>(inner_scope_);
-    size_t counter = 0;
-    for (auto arg : args){
-        new_scope->AddName(vars_[counter], arg->ComputeValue(full_scope));
-        ++counter;
-    }
-    new_scope = ConcatScopes(new_scope, scope);
-    return func_->ComputeValue(new_scope);
+bool Lambda::IsCompiled() const {
+    return jit_code_.load(std::memory_order_acquire) != nullptr;
+}
+
+size_t Lambda::CallCount() const {
+    return call_count_;
 }
 
-ValueType Define::Evaluate(std::vector<NodePtr> args, std::shared_ptr<Scope> scope) {
-    if (args.size() < 2){
-        throw SyntaxError("expected 2 arguments in define");
+size_t Lambda::BackEdgeCount() const {
+    return back_edge_count_;
+}
+
+ValueType Lambda::EvaluateTail(const ArgList& args,
+                               const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    GcSafepoint();
+    if (args.size() != arity_){
+        throw RuntimeError("wrong number of arguments in function call");
     }
-    if (args[0]->Type() == NodeType::VAR){
-        if (args.size() != 2){
-            throw SyntaxError("expected 2 arguments in define");
+    auto new_scope = MakeScope(inner_scope_, frame_size_, this);
+    size_t slot = 0;
+    for (auto& arg : args){
+        new_scope->Slot(0, slot++) = arg->ComputeValue(scope);
+    }
+    auto& stats = JitTierStats();
+    ++call_count_;
+    if (scope->Owner() == this){
+        ++back_edge_count_;
+        ++stats.back_edges;
+    }
+    if (!promoted_){
+        auto& thresholds = JitThresholds();
+        if (call_count_ >= thresholds.calls || back_edge_count_ >= thresholds.back_edges){
+            promoted_ = true;
+            auto code = JitCompile(this).release();
+            jit_code_.store(code, std::memory_order_release);
+            ++(code ? stats.promotions : stats.failed_promotions);
         }
-        auto value = args[1]->ComputeValue(scope);
-        scope->AddName(args[0]->ToString(), value);
-        return ValueType(NodePtr(new Empty()));
     }
-    if (args[0]->Type() == NodeType::PAIR){
-        auto decl = dynamic_cast<Pair*>(args[0].get())->ToVector();
-        decl.pop_back();
-        if (decl[0]->Type() != NodeType::VAR){
-            throw SyntaxError("invalid function declaration");
+    // only this thread stores the code
+    if (auto code = jit_code_.load(std::memory_order_relaxed)){
+        ++stats.compiled_calls;
+        return code->Run(std::move(new_scope), tail);
+    }
+    ++stats.interpreted_calls;
+    auto& body = dynamic_cast<FuncList*>(func_.get())->Elements();
+    for (size_t i = 0; i + 1 < body.size(); ++i){
+        body[i]->ComputeValue(new_scope);
+    }
+    *tail = {body.back(), std::move(new_scope)};
+    return ValueType();
+}
+
+CallExpr::CallExpr(NodePtr function, std::vector<NodePtr> args) :
+        function_(std::move(function)), args_(std::move(args)) {}
+
+NodeType CallExpr::Type() const {
+    return NodeType ::CALL;
+}
+
+ValueType CallExpr::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    return RunTailCalls(this, scope);
+}
+
+ValueType CallExpr::EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    ArgList args(args_);
+    if (cache_version_ == Scope::BindingVersion()){
+        // the global binding still owns the callee, the reference keeps it
+        // alive if the call itself rebinds the name
+        NodePtr callee(cached_func_);
+        if (fixnum_op_ != FixnumOp::NONE && feedback_ != TypeFeedback::GENERIC){
+            return EvaluateFixnum(scope);
         }
-        std::vector<std::string> var_names;
-        for (size_t i = 1; i < decl.size(); ++i){
-            if (decl[i]->Type() != NodeType::VAR){
-                throw SyntaxError("invalid function declaration");
-            }
-            var_names.push_back(decl[i]->ToString());
+        if (cached_tail_func_){
+            return cached_tail_func_->EvaluateTail(args, scope, tail);
+        }
+        return cached_func_->Evaluate(args, scope);
+    }
+    auto function = function_->ComputeValue(scope);
+    if (function_->Type() == NodeType::VAR && function.GetType() == ValueType::ValueEnum::FUNC){
+        if (auto func = dynamic_cast<Func*>(function.AsNode())){
+            cached_func_ = func;
+            cached_tail_func_ = dynamic_cast<TailFunc*>(func);
+            fixnum_op_ = args_.size() == 2 ? FixnumOpOf(func) : FixnumOp::NONE;
+            cache_version_ = Scope::BindingVersion();
+        }
+    }
+    return ApplyFunction(function, args, scope, tail);
+}
+
+ValueType CallExpr::EvaluateFixnum(const std::shared_ptr<Scope>& scope) {
+    ValueType values[] = {args_[0]->ComputeValue(scope), args_[1]->ComputeValue(scope)};
+    ValueType result;
+    if (ApplyFixnumOp(fixnum_op_, values[0], values[1], &result)){
+        feedback_ = TypeFeedback::FIXNUM;
+        return result;
+    }
+    feedback_ = TypeFeedback::GENERIC;
+    return static_cast<Primitive*>(cached_func_)->Apply(ArgSpan(values, 2));
+}
+
+std::string CallExpr::ToString() const {
+    std::string result = "(" + function_->ToString();
+    for (auto& arg : args_){
+        result += " " + arg->ToString();
+    }
+    return result + ")";
+}
+
+void CallExpr::Trace(Tracer* tracer) {
+    TraceNode(tracer, function_);
+    for (auto& arg : args_){
+        TraceNode(tracer, arg);
+    }
+}
+
+void CallExpr::ClearReferences() {
+    function_.reset();
+    args_.clear();
+}
+
+const NodePtr& CallExpr::Function() const {
+    return function_;
+}
+
+const std::vector<NodePtr>& CallExpr::Args() const {
+    return args_;
+}
+
+TypeFeedback CallExpr::Feedback() const {
+    return feedback_;
+}
+
+FixnumOp FixnumOpOf(Func* func) {
+    if (dynamic_cast<Plus*>(func)){
+        return FixnumOp::PLUS;
+    }
+    if (dynamic_cast<Minus*>(func)){
+        return FixnumOp::MINUS;
+    }
+    if (dynamic_cast<Mult*>(func)){
+        return FixnumOp::MULT;
+    }
+    if (dynamic_cast<Equal*>(func)){
+        return FixnumOp::EQUAL;
+    }
+    if (dynamic_cast<Less*>(func)){
+        return FixnumOp::LESS;
+    }
+    if (dynamic_cast<More*>(func)){
+        return FixnumOp::MORE;
+    }
+    if (dynamic_cast<LessEqual*>(func)){
+        return FixnumOp::LESS_EQUAL;
+    }
+    if (dynamic_cast<MoreEqual*>(func)){
+        return FixnumOp::MORE_EQUAL;
+    }
+    return FixnumOp::NONE;
+}
+
+FoldedExpr::FoldedExpr(ValueType value, std::vector<std::pair<Symbol, NodePtr>> guards,
+                       NodePtr original, NodePtr taken) :
+        value_(std::move(value)), guards_(std::move(guards)), original_(std::move(original)),
+        taken_(std::move(taken)) {}
+
+NodeType FoldedExpr::Type() const {
+    return NodeType ::FOLDED;
+}
+
+ValueType FoldedExpr::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    if (Holds(scope.get())){
+        return taken_ ? taken_->ComputeValue(scope) : value_;
+    }
+    return original_->ComputeValue(scope);
+}
+
+ValueType FoldedExpr::EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    if (Holds(scope.get())){
+        if (taken_){
+            *tail = {taken_, scope};
+            return ValueType();
         }
-        args.erase(args.begin());
-        auto func = NodePtr(
-                new Lambda(var_names, NodePtr(new FuncList(args)), scope));
-        scope->AddName(decl[0]->ToString(), ValueType(func));
+        return value_;
+    }
+    return original_->EvaluateTail(scope, tail);
+}
+
+std::string FoldedExpr::ToString() const {
+    return original_->ToString();
+}
+
+void FoldedExpr::Trace(Tracer* tracer) {
+    TraceValue(tracer, value_);
+    for (auto& guard : guards_){
+        TraceNode(tracer, guard.second);
+    }
+    TraceNode(tracer, original_);
+    TraceNode(tracer, taken_);
+}
+
+void FoldedExpr::ClearReferences() {
+    value_.Clear();
+    guards_.clear();
+    original_.reset();
+    taken_.reset();
+}
+
+bool FoldedExpr::Holds(Scope* scope) {
+    if (checked_version_ == Scope::BindingVersion()){
+        return true;
+    }
+    for (auto& guard : guards_){
+        auto binding = scope->GetBinding(guard.first);
+        if (!binding || binding->GetType() != ValueType::ValueEnum::FUNC ||
+                binding->AsNode() != guard.second.get()){
+            return false;
+        }
+    }
+    checked_version_ = Scope::BindingVersion();
+    return true;
+}
+
+const ValueType& FoldedExpr::Value() const {
+    return value_;
+}
+
+const std::vector<std::pair<Symbol, NodePtr>>& FoldedExpr::Guards() const {
+    return guards_;
+}
+
+const NodePtr& FoldedExpr::Original() const {
+    return original_;
+}
+
+const NodePtr& FoldedExpr::Taken() const {
+    return taken_;
+}
+
+IfExpr::IfExpr(NodePtr test, NodePtr consequent, NodePtr alternative) :
+        test_(std::move(test)), consequent_(std::move(consequent)),
+        alternative_(std::move(alternative)) {}
+
+NodeType IfExpr::Type() const {
+    return NodeType ::IF;
+}
+
+ValueType IfExpr::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    return RunTailCalls(this, scope);
+}
+
+ValueType IfExpr::EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    if (IsTrue(test_->ComputeValue(scope))){
+        *tail = {consequent_, scope};
+        return ValueType();
+    }
+    if (!alternative_){
         return ValueType(NodePtr(new Empty()));
     }
-    throw SyntaxError("invalid define syntax");
+    *tail = {alternative_, scope};
+    return ValueType();
 }
 
-ValueType Set::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
-    if (args.size() != 2){
-        throw SyntaxError("expected 2 arguments in set!");
+std::string IfExpr::ToString() const {
+    return "if";
+}
+
+void IfExpr::Trace(Tracer* tracer) {
+    TraceNode(tracer, test_);
+    TraceNode(tracer, consequent_);
+    TraceNode(tracer, alternative_);
+}
+
+void IfExpr::ClearReferences() {
+    test_.reset();
+    consequent_.reset();
+    alternative_.reset();
+}
+
+const NodePtr& IfExpr::Test() const {
+    return test_;
+}
+
+const NodePtr& IfExpr::Consequent() const {
+    return consequent_;
+}
+
+const NodePtr& IfExpr::Alternative() const {
+    return alternative_;
+}
+
+AssignExpr::AssignExpr(bool is_define, NodePtr target, NodePtr value) :
+        is_define_(is_define), target_(std::move(target)), value_(std::move(value)) {}
+
+NodeType AssignExpr::Type() const {
+    return is_define_ ? NodeType::DEFINE : NodeType::SET;
+}
+
+ValueType AssignExpr::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    auto value = value_->ComputeValue(scope);
+    if (target_->Type() == NodeType::LOCAL_VAR){
+        auto var = static_cast<LocalVar*>(target_.get());
+        if (is_define_){
+            var->Define(scope, value);
+        } else {
+            var->SetValue(scope, value);
+        }
+    } else {
+        auto name = static_cast<Var*>(target_.get())->GetSymbol();
+        if (is_define_){
+            scope->AddName(name, value);
+        } else {
+            scope->SetValue(name, value);
+        }
     }
-    scope->SetValue(args[0]->ToString(), args[1]->ComputeValue(scope));
     return ValueType(NodePtr(new Empty()));
 }
 
-ValueType LambdaForm::Evaluate(std::vector<NodePtr> args,
-                               std::shared_ptr<Scope> scope) {
-    if (args.size() < 2){
-        throw SyntaxError("invalid lambda definition");
+std::string AssignExpr::ToString() const {
+    return is_define_ ? "define" : "set!";
+}
+
+void AssignExpr::Trace(Tracer* tracer) {
+    TraceNode(tracer, target_);
+    TraceNode(tracer, value_);
+}
+
+void AssignExpr::ClearReferences() {
+    target_.reset();
+    value_.reset();
+}
+
+const NodePtr& AssignExpr::Target() const {
+    return target_;
+}
+
+const NodePtr& AssignExpr::Value() const {
+    return value_;
+}
+
+LogicExpr::LogicExpr(bool is_and, std::vector<NodePtr> args) :
+        is_and_(is_and), args_(std::move(args)) {}
+
+NodeType LogicExpr::Type() const {
+    return is_and_ ? NodeType::AND : NodeType::OR;
+}
+
+ValueType LogicExpr::ComputeValue(const std::shared_ptr<Scope>& scope) {
+    return RunTailCalls(this, scope);
+}
+
+ValueType LogicExpr::EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) {
+    if (args_.empty()){
+        return ValueType(is_and_);
     }
-    std::vector<std::string> var_names;
-    if (args[0]->Type() == NodeType::PAIR) {
-        auto decl = dynamic_cast<Pair *>(args[0].get())->ToVector();
-        decl.pop_back();
-        for (auto var : decl) {
-            if (var->Type() != NodeType::VAR) {
-                throw SyntaxError("invalid function declaration");
-            }
-            var_names.push_back(var->ToString());
+    for (size_t i = 0; i + 1 < args_.size(); ++i){
+        auto value = args_[i]->ComputeValue(scope);
+        if (IsTrue(value) != is_and_){
+            return value;
         }
     }
-    args.erase(args.begin());
-    return ValueType(NodePtr(
-            new Lambda(var_names, NodePtr(new FuncList(args)), scope)));
+    *tail = {args_.back(), scope};
+    return ValueType();
+}
+
+std::string LogicExpr::ToString() const {
+    return is_and_ ? "and" : "or";
+}
+
+void LogicExpr::Trace(Tracer* tracer) {
+    for (auto& arg : args_){
+        TraceNode(tracer, arg);
+    }
+}
+
+void LogicExpr::ClearReferences() {
+    args_.clear();
+}
+
+const std::vector<NodePtr>& LogicExpr::Args() const {
+    return args_;
 }
 
 bool IsNull(const ValueType& value){
@@ -289,18 +915,33 @@ bool IsPair(const NodePtr& node){
     return node->Type() == NodeType::PAIR;
 }
 
+Pair* AsPair(const ValueType& value){
+    if (value.GetType() == ValueType::ValueEnum::FUNC && value.AsNode()->Type() == NodeType::PAIR){
+        return static_cast<Pair*>(value.AsNode());
+    }
+    return nullptr;
+}
+
 bool IsList(const NodePtr& node){
     if (node->Type() == NodeType::EMPTY){
         return true;
     }
     if (IsPair(node)){
-        if (dynamic_cast<Pair*>(node.get())->ToVector().back()->Type()==NodeType::EMPTY){
+        if (IsNull(static_cast<Pair*>(node.get())->Last()->CdrValue())){
             return true;
         }
     }
     return false;
 }
 
+// checks that value may be stored in a pair
+static ValueType ListElement(const ValueType& value){
+    if (value.GetType() == ValueType::ValueEnum::UNDEFINED){
+        throw RuntimeError("unexpectable argument type");
+    }
+    return value;
+}
+
 NodePtr NodeFromValue(ValueType value){
     if (IsInt(value)){
         return NodePtr(new Const(value));
@@ -317,27 +958,65 @@ NodePtr NodeFromValue(ValueType value){
     }
 }
 
-NodePtr ListFromVector(std::vector<NodePtr> elements){
-    if (elements.empty()){
-        return NodePtr(new Empty());
+ValueType ValueFromNode(const NodePtr& node){
+    if (node->Type() == NodeType::CONST){
+        return node->ComputeValue(nullptr);
     }
-    elements.push_back(NodePtr(new Empty()));
-    int it = elements.size() - 2;
-    auto pair = NodePtr(new Pair(elements[it], elements.back()));
-    --it;
-    while (it >= 0){
-        pair = NodePtr(new Pair(elements[it], pair));
-        --it;
+    return ValueType(node);
+}
+
+NodePtr NodeFromArgument(const ValueType& value){
+    if (value.GetType() == ValueType::ValueEnum::FUNC){
+        return NodePtr(new Quote(value.GetValue<NodePtr>()));
     }
-    return pair;
+    return NodePtr(new Const(value));
+}
+
+NodePtr ListFromVector(std::vector<NodePtr> elements){
+    std::vector<ValueType> values;
+    for (auto& element : elements){
+        values.push_back(ValueFromNode(element));
+    }
+    return ListFromValues(values);
+}
 
+NodePtr ListFromValues(const std::vector<ValueType>& values){
+    return ListFromValues(values, ValueType(NodePtr(new Empty())));
 }
 
-ValueType Plus::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+NodePtr ListFromValues(const std::vector<ValueType>& values, ValueType last){
+    if (values.empty()){
+        return NodeFromValue(std::move(last));
+    }
+    auto heap = Heap::Current();
+    PoolArena arena(heap ? heap->Pool() : nullptr);
+    // made front to back, so the pairs are laid out in list order
+    std::vector<NodePtr> pairs;
+    pairs.reserve(values.size());
+    for (auto& value : values){
+        pairs.push_back(NodePtr(new Pair(value, ValueType())));
+    }
+    for (size_t i = 0; i + 1 < pairs.size(); ++i){
+        static_cast<Pair*>(pairs[i].get())->SetCdr(ValueType(pairs[i + 1]));
+    }
+    static_cast<Pair*>(pairs.back().get())->SetCdr(std::move(last));
+    if (pairs.size() > 1){
+        GcVector<Pair*> run_pairs;
+        run_pairs.reserve(pairs.size());
+        for (auto& pair : pairs){
+            run_pairs.push_back(static_cast<Pair*>(pair.get()));
+        }
+        auto run = new PairRun{0, std::move(run_pairs)};
+        for (size_t i = 0; i < run->pairs.size(); ++i){
+            run->pairs[i]->JoinRun(run, i);
+        }
+    }
+    return pairs.front();
+}
+
+ValueType Plus::Apply(ArgSpan args) {
     int64_t sum = 0;
-    for (auto& arg : args){
-        auto value = arg->ComputeValue(scope);
+    for (auto& value : args){
         if (! IsInt(value)){
             throw RuntimeError("required number in +");
         }
@@ -346,33 +1025,26 @@ ValueType Plus::Evaluate(std::vector<NodePtr> args,
     return ValueType(sum);
 }
 
-ValueType Minus::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+ValueType Minus::Apply(ArgSpan args) {
     if (args.empty()){
         throw RuntimeError("expected at least 1 argument in -");
     }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
+    if (! IsInt(args[0])){
         throw RuntimeError("required number in -");
     }
-    int64_t res = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    int64_t res = args[0].GetValue<int64_t>();
+    for (size_t i = 1; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in -");
         }
-        res -= value.GetValue<int64_t>();
+        res -= args[i].GetValue<int64_t>();
     }
     return ValueType(res);
 }
 
-ValueType Mult::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+ValueType Mult::Apply(ArgSpan args) {
     int64_t res = 1;
-    for (auto& arg : args){
-        auto value = arg->ComputeValue(scope);
+    for (auto& value : args){
         if (! IsInt(value)){
             throw RuntimeError("required number in *");
         }
@@ -381,161 +1053,88 @@ ValueType Mult::Evaluate(std::vector<NodePtr> args,
     return ValueType(res);
 }
 
-ValueType Div::Evaluate(std::vector<NodePtr> args,
-                          std::shared_ptr<Scope> scope) {
+ValueType Div::Apply(ArgSpan args) {
     if (args.empty()){
         throw RuntimeError("expected at least 1 argument in /");
     }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
+    if (! IsInt(args[0])){
         throw RuntimeError("required number in /");
     }
-    int64_t res = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    int64_t res = args[0].GetValue<int64_t>();
+    for (size_t i = 1; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in /");
         }
-        if (value.GetValue<int64_t>() == 0){
+        if (args[i].GetValue<int64_t>() == 0){
             throw RuntimeError("division by zero");
         }
-        res /= value.GetValue<int64_t>();
+        res /= args[i].GetValue<int64_t>();
     }
     return ValueType(res);
 }
 
-ValueType QuoteForm::Evaluate(std::vector<NodePtr> args,
-                              std::shared_ptr<Scope> scope) {
-    if (args.size() != 1){
-        throw SyntaxError("expected 1 argument in quote");
-    }
-    return ValueType(args[0]);
-}
-
-    ValueType IfElse::Evaluate(std::vector<NodePtr> args,
-                           std::shared_ptr<Scope> scope) {
-    if (! (args.size() == 2 || args.size() == 3)){
-        throw SyntaxError("expected 2 or 3 arguments in if");
-    }
-    bool condition = IsTrue(args[0]->ComputeValue(scope));
-    if (condition){
-        return args[1]->ComputeValue(scope);
-    }
-    if (args.size() == 2){
-        return ValueType(NodePtr(new Empty()));
-    }
-    return args[2]->ComputeValue(scope);
-}
-
-ValueType And::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
-    bool res = true;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    ValueType value;
-    while (res && arg != args.end()){
-        value = (*arg)->ComputeValue(scope);
-        res = res && IsTrue(value);
-        ++arg;
-    }
-    return value;
-}
-
-ValueType Or::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
-    bool res = false;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    ValueType value;
-    while (!res && arg != args.end()){
-        value = (*arg)->ComputeValue(scope);
-        res = res || IsTrue(value);
-        ++arg;
-    }
-    return value;
-}
-
-ValueType Not::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
+ValueType Not::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in not");
     }
-    return ValueType(!IsTrue(args[0]->ComputeValue(scope)));
+    return ValueType(!IsTrue(args[0]));
 }
 
-ValueType NullPredicate::Evaluate(std::vector<NodePtr> args,
-                                  std::shared_ptr<Scope> scope) {
+ValueType NullPredicate::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in null?");
     }
-    auto value = args[0]->ComputeValue(scope);
-    return ValueType(IsNull(value));
+    return ValueType(IsNull(args[0]));
 }
 
-ValueType PairPredicate::Evaluate(std::vector<NodePtr> args,
-                                  std::shared_ptr<Scope> scope) {
+ValueType PairPredicate::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in pair?");
     }
-    auto value = args[0]->ComputeValue(scope);
-    if (value.GetType() == ValueType::ValueEnum::FUNC){
-        return ValueType(IsPair(value.GetValue<NodePtr>()));
+    if (args[0].GetType() == ValueType::ValueEnum::FUNC){
+        return ValueType(IsPair(args[0].GetValue<NodePtr>()));
     }
     return ValueType(false);
 }
 
-ValueType NumberPredicate::Evaluate(std::vector<NodePtr> args,
-                                  std::shared_ptr<Scope> scope) {
+ValueType NumberPredicate::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in number?");
     }
-    return ValueType(IsInt(args[0]->ComputeValue(scope)));
+    return ValueType(IsInt(args[0]));
 }
 
-ValueType BoolPredicate::Evaluate(std::vector<NodePtr> args,
-                                    std::shared_ptr<Scope> scope) {
+ValueType BoolPredicate::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in bool?");
     }
-    return ValueType(IsBool(args[0]->ComputeValue(scope)));
+    return ValueType(IsBool(args[0]));
 }
 
-ValueType SymbolPredicate::Evaluate(std::vector<NodePtr> args,
-                                    std::shared_ptr<Scope> scope) {
+ValueType SymbolPredicate::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in symbol?");
     }
-    auto value = args[0]->ComputeValue(scope);
-    if (value.GetType() == ValueType::ValueEnum::FUNC){
-        return ValueType(value.GetValue<NodePtr>()->Type()==NodeType::VAR);
+    if (args[0].GetType() == ValueType::ValueEnum::FUNC){
+        return ValueType(args[0].GetValue<NodePtr>()->Type()==NodeType::VAR);
     }
     return ValueType(false);
 }
 
-ValueType ListPredicate::Evaluate(std::vector<NodePtr> args,
-                                  std::shared_ptr<Scope> scope) {
+ValueType ListPredicate::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in list?");
     }
-    auto value = args[0]->ComputeValue(scope);
-    if (value.GetType() == ValueType::ValueEnum::FUNC){
-        return ValueType(IsList(value.GetValue<NodePtr>()));
+    if (args[0].GetType() == ValueType::ValueEnum::FUNC){
+        return ValueType(IsList(args[0].GetValue<NodePtr>()));
     }
     return ValueType(false);
 }
 
-bool IsEqual(NodePtr first_ptr, NodePtr second_ptr, std::shared_ptr<Scope> scope){
-    auto first = first_ptr->ComputeValue(scope);
-    auto second = second_ptr->ComputeValue(scope);
+bool IsEqual(const ValueType& first, const ValueType& second){
     if (first.GetType() == second.GetType()){
         if (IsNull(first)){
-            return true;
+            return IsNull(second);
         }
         if (IsBool(first)){
             return first.GetValue<bool>() == second.GetValue<bool>();
@@ -547,27 +1146,21 @@ bool IsEqual(NodePtr first_ptr, NodePtr second_ptr, std::shared_ptr<Scope> scope
             auto first_node = first.GetValue<NodePtr>();
             auto second_node = second.GetValue<NodePtr>();
             if (IsPair(first_node) && IsPair(second_node)){
-                auto first_vector = dynamic_cast<Pair*>(first_node.get())->ToVector();
-                auto second_vector = dynamic_cast<Pair*>(second_node.get())->ToVector();
-                if (first_vector.size() != second_vector.size()){
+                auto first_values = static_cast<Pair*>(first_node.get())->ToValues();
+                auto second_values = static_cast<Pair*>(second_node.get())->ToValues();
+                if (first_values.size() != second_values.size()){
                     return false;
                 }
-                if (IsList(first_node) && IsList(second_node)){
-                    first_vector.pop_back();
-                    second_vector.pop_back();
-                } else {
-                    if (IsList(first_node) || IsList(second_node)){
+                for (size_t i = 0; i < first_values.size(); ++i){
+                    if (!IsEqual(first_values[i], second_values[i])){
                         return false;
                     }
                 }
-                bool result = true;
-                for (size_t i = 0; i < first_vector.size(); ++i){
-                    result = result && IsEqual(first_vector[i], second_vector[i], scope);
-                }
-                return result;
+                return true;
             }
             if (first_node->Type() == NodeType::VAR && second_node->Type() == NodeType::VAR){
-                return first_node->ToString() == second_node->ToString();
+                return static_cast<Var*>(first_node.get())->GetSymbol() ==
+                       static_cast<Var*>(second_node.get())->GetSymbol();
             }
             return first_node.get() == second_node.get();
         }
@@ -576,24 +1169,22 @@ bool IsEqual(NodePtr first_ptr, NodePtr second_ptr, std::shared_ptr<Scope> scope
     return false;
 }
 
-ValueType EqualPredicate::Evaluate(std::vector<NodePtr> args,
-                                  std::shared_ptr<Scope> scope) {
+ValueType EqualPredicate::Apply(ArgSpan args) {
     if (args.size() != 2){
         throw RuntimeError("expected 2 arguments in equal?");
     }
-    return ValueType(IsEqual(args[0], args[1], scope));
+    return ValueType(IsEqual(args[0], args[1]));
 }
 
-ValueType EqPredicate::Evaluate(std::vector<NodePtr> args,
-                                   std::shared_ptr<Scope> scope) {
+ValueType EqPredicate::Apply(ArgSpan args) {
     if (args.size() != 2){
         throw RuntimeError("expected 2 arguments in equal?");
     }
-    auto first = args[0]->ComputeValue(scope);
-    auto second = args[1]->ComputeValue(scope);
+    auto& first = args[0];
+    auto& second = args[1];
     if (first.GetType() == second.GetType()){
         if (IsNull(first)){
-            return ValueType(true);
+            return ValueType(IsNull(second));
         }
         if (IsBool(first)){
             return ValueType(first.GetValue<bool>() == second.GetValue<bool>());
@@ -602,13 +1193,13 @@ ValueType EqPredicate::Evaluate(std::vector<NodePtr> args,
             return ValueType(first.GetValue<int64_t>() == second.GetValue<int64_t>());
         }
         if (first.GetType() == ValueType::ValueEnum::FUNC){
-            if (first.GetValue<NodePtr>()->Type() == NodeType::VAR &&
-                    second.GetValue<NodePtr>()->Type() == NodeType::VAR){
-                return ValueType(first.GetValue<NodePtr>()->ToString() ==
-                                         second.GetValue<NodePtr>()->ToString());
+            auto first_node = first.AsNode();
+            auto second_node = second.AsNode();
+            if (first_node->Type() == NodeType::VAR && second_node->Type() == NodeType::VAR){
+                return ValueType(static_cast<Var*>(first_node)->GetSymbol() ==
+                                 static_cast<Var*>(second_node)->GetSymbol());
             }
-            return ValueType(first.GetValue<NodePtr>().get() ==
-                                     second.GetValue<NodePtr>().get());
+            return ValueType(first_node == second_node);
         }
         throw RuntimeError("unknown type in equal?");
     }
@@ -616,283 +1207,370 @@ ValueType EqPredicate::Evaluate(std::vector<NodePtr> args,
 }
 
 
-ValueType IntEqualPredicate::Evaluate(std::vector<NodePtr> args,
-                                   std::shared_ptr<Scope> scope) {
+ValueType IntEqualPredicate::Apply(ArgSpan args) {
     if (args.size() != 2){
         throw RuntimeError("expected 2 arguments in equal?");
     }
-    auto first = args[0]->ComputeValue(scope);
-    auto second = args[1]->ComputeValue(scope);
-    if (IsInt(first) && IsInt(second)) {
-        return ValueType(first.GetValue<int64_t>() == second.GetValue<int64_t>());
+    if (IsInt(args[0]) && IsInt(args[1])) {
+        return ValueType(args[0].GetValue<int64_t>() == args[1].GetValue<int64_t>());
     }
     throw RuntimeError("expected integers in integer-equal?");
 }
 
-ValueType Equal::Evaluate(std::vector<NodePtr> args,
-                          std::shared_ptr<Scope> scope) {
+ValueType Equal::Apply(ArgSpan args) {
     bool res = true;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
-        throw RuntimeError("required number in =");
-    }
-    int64_t current = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    for (size_t i = 0; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in =");
         }
-        res = res && (value.GetValue<int64_t>() == current);
+        if (i > 0){
+            res = res && (args[i].GetValue<int64_t>() == args[0].GetValue<int64_t>());
+        }
     }
     return ValueType(res);
 }
 
-ValueType More::Evaluate(std::vector<NodePtr> args,
-                          std::shared_ptr<Scope> scope) {
+ValueType More::Apply(ArgSpan args) {
     bool res = true;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
-        throw RuntimeError("required number in >");
-    }
-    int64_t current = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    for (size_t i = 0; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in >");
         }
-        res = res && (current > value.GetValue<int64_t>());
-        current = value.GetValue<int64_t>();
+        if (i > 0){
+            res = res && (args[i - 1].GetValue<int64_t>() > args[i].GetValue<int64_t>());
+        }
     }
     return ValueType(res);
 }
 
-ValueType Less::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+ValueType Less::Apply(ArgSpan args) {
     bool res = true;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
-        throw RuntimeError("required number in <");
-    }
-    int64_t current = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    for (size_t i = 0; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in <");
         }
-        res = res && (current < value.GetValue<int64_t>());
-        current = value.GetValue<int64_t>();
+        if (i > 0){
+            res = res && (args[i - 1].GetValue<int64_t>() < args[i].GetValue<int64_t>());
+        }
     }
     return ValueType(res);
 }
 
-ValueType MoreEqual::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+ValueType MoreEqual::Apply(ArgSpan args) {
     bool res = true;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
-        throw RuntimeError("required number in >=");
-    }
-    int64_t current = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    for (size_t i = 0; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in >=");
         }
-        res = res && (current >= value.GetValue<int64_t>());
-        current = value.GetValue<int64_t>();
+        if (i > 0){
+            res = res && (args[i - 1].GetValue<int64_t>() >= args[i].GetValue<int64_t>());
+        }
     }
     return ValueType(res);
 }
 
-ValueType LessEqual::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+ValueType LessEqual::Apply(ArgSpan args) {
     bool res = true;
-    if (args.empty()){
-        return ValueType(res);
-    }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
-        throw RuntimeError("required number in <=");
-    }
-    int64_t current = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    for (size_t i = 0; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in <=");
         }
-        res = res && (current <= value.GetValue<int64_t>());
-        current = value.GetValue<int64_t>();
+        if (i > 0){
+            res = res && (args[i - 1].GetValue<int64_t>() <= args[i].GetValue<int64_t>());
+        }
     }
     return ValueType(res);
 }
 
-ValueType Min::Evaluate(std::vector<NodePtr> args,
-                              std::shared_ptr<Scope> scope) {
+ValueType Min::Apply(ArgSpan args) {
     if (args.empty()){
         throw RuntimeError("expected at least 1 argument in min");
     }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
+    if (! IsInt(args[0])){
         throw RuntimeError("required number in min");
     }
-    int64_t res = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    int64_t res = args[0].GetValue<int64_t>();
+    for (size_t i = 1; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in min");
         }
-        if (value.GetValue<int64_t>() < res){
-            res = value.GetValue<int64_t>();
+        if (args[i].GetValue<int64_t>() < res){
+            res = args[i].GetValue<int64_t>();
         }
     }
     return ValueType(res);
 }
 
-ValueType Max::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
+ValueType Max::Apply(ArgSpan args) {
     if (args.empty()){
         throw RuntimeError("expected at least 1 argument in max");
     }
-    auto arg = args.begin();
-    auto value = (*arg)->ComputeValue(scope);
-    if (! IsInt(value)){
+    if (! IsInt(args[0])){
         throw RuntimeError("required number in max");
     }
-    int64_t res = value.GetValue<int64_t>();
-    ++arg;
-    for (arg; arg < args.end(); ++arg){
-        value = (*arg)->ComputeValue(scope);
-        if (! IsInt(value)){
+    int64_t res = args[0].GetValue<int64_t>();
+    for (size_t i = 1; i < args.size(); ++i){
+        if (! IsInt(args[i])){
             throw RuntimeError("required number in max");
         }
-        if (value.GetValue<int64_t>() > res){
-            res = value.GetValue<int64_t>();
+        if (args[i].GetValue<int64_t>() > res){
+            res = args[i].GetValue<int64_t>();
         }
     }
     return ValueType(res);
 }
 
-ValueType Abs::Evaluate(std::vector<NodePtr> args,
-                                    std::shared_ptr<Scope> scope) {
+ValueType Abs::Apply(ArgSpan args) {
     if (args.size() != 1){
         throw RuntimeError("expected 1 argument in abs");
     }
-    auto value = args[0]->ComputeValue(scope);
-    if (IsInt(value)){
-        return ValueType(static_cast<int64_t >(std::llabs(value.GetValue<int64_t>())));
+    if (IsInt(args[0])){
+        return ValueType(static_cast<int64_t >(std::llabs(args[0].GetValue<int64_t>())));
     }
     throw RuntimeError("expected number in abs");
 }
 
-ValueType Cons::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
+ValueType Cons::Apply(ArgSpan args) {
     if (args.size() != 2){
         throw RuntimeError("expected 2 arguments in cons");
     }
-    auto car_value = args[0]->ComputeValue(scope);
-    auto cdr_value = args[1]->ComputeValue(scope);
-    auto car = NodeFromValue(car_value);
-    auto cdr = NodeFromValue(cdr_value);
-    return ValueType(NodePtr(new Pair(car, cdr)));
+    return ValueType(NodePtr(new Pair(ListElement(args[0]), ListElement(args[1]))));
 }
 
-ValueType Car::Evaluate(std::vector<NodePtr> args,
-                         std::shared_ptr<Scope> scope) {
+ValueType Car::Apply(ArgSpan args) {
     if (args.size() != 1) {
         throw RuntimeError("expected 1 argument in car");
     }
-    auto list = NodeFromValue(args[0]->ComputeValue(scope));
-    if (IsPair(list)){
-        return ValueType(dynamic_cast<Pair*>(list.get())->Car());
+    if (auto pair = AsPair(args[0])){
+        return pair->CarValue();
     }
     throw RuntimeError("expected pair in car");
 }
 
-ValueType Cdr::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
+ValueType Cdr::Apply(ArgSpan args) {
     if (args.size() != 1) {
         throw RuntimeError("expected 1 argument in cdr");
     }
-    auto list = NodeFromValue(args[0]->ComputeValue(scope));
-    if (IsPair(list)){
-        return ValueType(dynamic_cast<Pair*>(list.get())->Cdr());
+    if (auto pair = AsPair(args[0])){
+        return pair->CdrValue();
     }
     throw RuntimeError("expected pair in cdr");
 }
 
-ValueType SetCar::Evaluate(std::vector<NodePtr> args,
-                        std::shared_ptr<Scope> scope) {
+ValueType SetCar::Apply(ArgSpan args) {
     if (args.size() != 2) {
         throw RuntimeError("expected 2 arguments in set-car!");
     }
-    auto list = NodeFromValue(args[0]->ComputeValue(scope));
-    if (IsPair(list)){
-        dynamic_cast<Pair*>(list.get())->SetCar(NodeFromValue(args[1]->ComputeValue(scope)));
+    if (auto pair = AsPair(args[0])){
+        pair->SetCar(ListElement(args[1]));
         return ValueType(NodePtr(new Empty()));
     }
     throw RuntimeError("expected pair in set-car!");
 }
 
-ValueType SetCdr::Evaluate(std::vector<NodePtr> args,
-                           std::shared_ptr<Scope> scope) {
+ValueType SetCdr::Apply(ArgSpan args) {
     if (args.size() != 2) {
         throw RuntimeError("expected 2 arguments in set-cdr!");
     }
-    auto list = NodeFromValue(args[0]->ComputeValue(scope));
-    if (IsPair(list)){
-        dynamic_cast<Pair*>(list.get())->SetCdr(NodeFromValue(args[1]->ComputeValue(scope)));
+    if (auto pair = AsPair(args[0])){
+        pair->SetCdr(ListElement(args[1]));
         return ValueType(NodePtr(new Empty()));
     }
     throw RuntimeError("expected pair in set-cdr!");
 }
 
-ValueType ListForm::Evaluate(std::vector<NodePtr> args,
-                             std::shared_ptr<Scope> scope) {
-    std::vector<NodePtr> values;
-    for (auto& el : args){
-        values.push_back(NodeFromValue(el->ComputeValue(scope)));
+ValueType ListForm::Apply(ArgSpan args) {
+    std::vector<ValueType> values;
+    for (auto& value : args){
+        values.push_back(ListElement(value));
+    }
+    return ValueType(ListFromValues(values));
+}
+
+static NodePtr StatsEntry(const std::string& name, size_t value) {
+    return NodePtr(new Pair(ValueType(NodePtr(new Var(name))),
+                            ValueType(static_cast<int64_t>(value))));
+}
+
+ValueType TierStatsForm::Apply(ArgSpan args) {
+    if (args.empty()){
+        auto& thresholds = JitThresholds();
+        auto& stats = JitTierStats();
+        return ValueType(ListFromVector({
+                StatsEntry("call-threshold", thresholds.calls),
+                StatsEntry("back-edge-threshold", thresholds.back_edges),
+                StatsEntry("interpreted-calls", stats.interpreted_calls),
+                StatsEntry("compiled-calls", stats.compiled_calls),
+                StatsEntry("back-edges", stats.back_edges),
+                StatsEntry("promotions", stats.promotions),
+                StatsEntry("failed-promotions", stats.failed_promotions)}));
+    }
+    if (args.size() != 1){
+        throw RuntimeError("expected at most 1 argument in tier-stats");
+    }
+    auto func = args[0].GetType() == ValueType::ValueEnum::FUNC ?
+                args[0].AsNode()->AsFunc() : nullptr;
+    if (!func || !func->IsClosure()){
+        throw RuntimeError("expected lambda in tier-stats");
+    }
+    auto lambda = dynamic_cast<Lambda*>(func);
+    auto tier = NodePtr(new Pair(NodePtr(new Var("tier")), NodePtr(new Var(
+            lambda && lambda->IsCompiled() ? "compiled" : "interpreted"))));
+    return ValueType(ListFromVector({
+            tier,
+            StatsEntry("calls", func->CallCount()),
+            StatsEntry("back-edges", func->BackEdgeCount())}));
+}
+
+ValueType TierConfigForm::Apply(ArgSpan args) {
+    if (args.size() > 2){
+        throw RuntimeError("expected at most 2 arguments in tier-config");
+    }
+    for (auto& arg : args){
+        if (!IsInt(arg) || arg.AsInt() < 0){
+            throw RuntimeError("expected non-negative threshold in tier-config");
+        }
+    }
+    auto& thresholds = JitThresholds();
+    if (!args.empty()){
+        thresholds.calls = args[0].AsInt();
+    }
+    if (args.size() == 2){
+        thresholds.back_edges = args[1].AsInt();
     }
-    return ValueType(ListFromVector(values));
+    return ValueType(ListFromVector({
+            StatsEntry("call-threshold", thresholds.calls),
+            StatsEntry("back-edge-threshold", thresholds.back_edges)}));
 }
 
-ValueType ListRef::Evaluate(std::vector<NodePtr> args,
-                           std::shared_ptr<Scope> scope) {
+static Heap* InterpreterHeap(const std::string& name) {
+    auto heap = Heap::Current();
+    if (!heap){
+        throw RuntimeError(name + " is only available in an interpreter");
+    }
+    return heap;
+}
+
+static size_t Micros(std::chrono::nanoseconds duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+ValueType GcConfigForm::Apply(ArgSpan args) {
+    auto heap = InterpreterHeap("gc-config");
+    if (args.size() > 2){
+        throw RuntimeError("expected at most 2 arguments in gc-config");
+    }
+    if (!args.empty()){
+        if (!IsInt(args[0]) || args[0].AsInt() < 0){
+            throw RuntimeError("expected non-negative pause in gc-config");
+        }
+        if (args.size() == 2 && !IsBool(args[1])){
+            throw RuntimeError("expected boolean in gc-config");
+        }
+        auto config = heap->Config();
+        config.max_pause = std::chrono::microseconds(args[0].AsInt());
+        if (args.size() == 2){
+            config.concurrent = args[1].AsBool();
+        }
+        heap->SetConfig(config);
+    }
+    auto concurrent = NodePtr(new Pair(ValueType(NodePtr(new Var("concurrent"))),
+                                       ValueType(heap->Config().concurrent)));
+    return ValueType(ListFromVector({
+            StatsEntry("max-pause-us", heap->Config().max_pause.count()), concurrent}));
+}
+
+HeapStats MeasureHeap(const Heap& heap) {
+    HeapStats stats;
+    heap.ForEachObject([&stats](GcObject* object) {
+        if (dynamic_cast<Scope*>(object)){
+            ++stats.scopes;
+            return;
+        }
+        auto node = dynamic_cast<ASTNode*>(object);
+        if (!node){
+            // code of VM functions
+            ++stats.other;
+            return;
+        }
+        auto func = node->AsFunc();
+        if (func && func->IsClosure()){
+            ++stats.closures;
+        } else if (node->Type() == NodeType::PAIR){
+            ++stats.pairs;
+        } else if (node->Type() == NodeType::CONST){
+            ++stats.consts;
+        } else {
+            ++stats.other;
+        }
+    });
+    stats.live_bytes = heap.Pool()->LiveBytes();
+    stats.reserved_bytes = heap.Pool()->ReservedBytes();
+    stats.bytes_allocated = heap.BytesAllocated();
+    stats.objects_allocated = heap.ObjectsAllocated();
+    auto age = std::chrono::duration_cast<std::chrono::microseconds>(heap.Age()).count();
+    stats.allocation_rate = age > 0 ? stats.bytes_allocated * 1000000.0 / age : 0;
+    stats.collections = heap.Collections();
+    stats.minor_collections = heap.MinorCollections();
+    stats.pauses = heap.Pauses();
+    return stats;
+}
+
+ValueType HeapStatsForm::Apply(ArgSpan args) {
+    if (!args.empty()){
+        throw RuntimeError("expected no arguments in heap-stats");
+    }
+    auto stats = MeasureHeap(*InterpreterHeap("heap-stats"));
+    return ValueType(ListFromVector({
+            StatsEntry("pairs", stats.pairs),
+            StatsEntry("consts", stats.consts),
+            StatsEntry("closures", stats.closures),
+            StatsEntry("scopes", stats.scopes),
+            StatsEntry("other", stats.other),
+            StatsEntry("live-bytes", stats.live_bytes),
+            StatsEntry("reserved-bytes", stats.reserved_bytes),
+            StatsEntry("bytes-allocated", stats.bytes_allocated),
+            StatsEntry("objects-allocated", stats.objects_allocated),
+            StatsEntry("allocation-rate", stats.allocation_rate),
+            StatsEntry("collections", stats.collections),
+            StatsEntry("minor-collections", stats.minor_collections),
+            StatsEntry("pauses", stats.pauses.pauses),
+            StatsEntry("pause-total-us", Micros(stats.pauses.total)),
+            StatsEntry("pause-max-us", Micros(stats.pauses.max))}));
+}
+
+ValueType GcPausesForm::Apply(ArgSpan args) {
+    if (!args.empty()){
+        throw RuntimeError("expected no arguments in gc-pauses");
+    }
+    auto& pauses = InterpreterHeap("gc-pauses")->Pauses();
+    std::vector<NodePtr> buckets;
+    for (size_t i = 0; i < PauseHistogram::kBuckets; ++i){
+        if (pauses.buckets[i]){
+            size_t bound = i + 1 < PauseHistogram::kBuckets ? size_t(1) << i : 0;
+            buckets.push_back(NodePtr(new Pair(ValueType(static_cast<int64_t>(bound)),
+                                               ValueType(static_cast<int64_t>(pauses.buckets[i])))));
+        }
+    }
+    return ValueType(ListFromVector({
+            StatsEntry("pauses", pauses.pauses),
+            StatsEntry("total-us", Micros(pauses.total)),
+            StatsEntry("max-us", Micros(pauses.max)),
+            NodePtr(new Pair(NodePtr(new Var("histogram")), ListFromVector(buckets)))}));
+}
+
+ValueType ListRef::Apply(ArgSpan args) {
     if (args.size() != 2) {
         throw RuntimeError("expected 2 arguments in list-ref");
     }
-    auto list_node = NodeFromValue(args[0]->ComputeValue(scope));
-    if (IsList(list_node)){
-        auto list = dynamic_cast<Pair*>(list_node.get())->ToVector();
-        list.pop_back();
-        auto pos_value = args[1]->ComputeValue(scope);
-        if (IsInt(pos_value)){
-            int64_t pos = pos_value.GetValue<int64_t>();
-            if (pos < list.size()){
-                return ValueType(list[pos]);
+    auto pair = AsPair(args[0]);
+    if (pair && IsList(args[0].GetValue<NodePtr>())){
+        if (IsInt(args[1])){
+            int64_t pos = args[1].GetValue<int64_t>();
+            if (pos >= 0){
+                if (auto element = pair->Tail(pos)){
+                    return element->CarValue();
+                }
             }
             throw RuntimeError("index out of range");
         }
@@ -901,25 +1579,23 @@ ValueType ListRef::Evaluate(std::vector<NodePtr> args,
     throw RuntimeError("expected list in list-ref");
 }
 
-ValueType ListTail::Evaluate(std::vector<NodePtr> args,
-                            std::shared_ptr<Scope> scope) {
+ValueType ListTail::Apply(ArgSpan args) {
     if (args.size() != 2) {
         throw RuntimeError("expected 2 arguments in list-tail");
     }
-    auto list_node = NodeFromValue(args[0]->ComputeValue(scope));
-    if (IsList(list_node)){
-        auto list = dynamic_cast<Pair*>(list_node.get())->ToVector();
-        auto pos_value = args[1]->ComputeValue(scope);
-        if (IsInt(pos_value)){
-            int64_t pos = pos_value.GetValue<int64_t>();
-            if (pos < list.size()){
-                std::vector<NodePtr> elements;
-                while (pos < list.size()){
-                    elements.push_back(list[pos]);
-                    ++pos;
+    auto pair = AsPair(args[0]);
+    if (pair && IsList(args[0].GetValue<NodePtr>())){
+        if (IsInt(args[1])){
+            int64_t pos = args[1].GetValue<int64_t>();
+            if (pos >= 0){
+                if (auto rest = pair->Tail(pos)){
+                    auto elements = rest->ToValues();
+                    elements.pop_back();
+                    return ValueType(ListFromValues(elements));
+                }
+                if (pos > 0 && pair->Tail(pos - 1)){
+                    return ValueType(NodePtr(new Empty()));
                 }
-                elements.pop_back();
-                return ValueType(ListFromVector(elements));
             }
             throw RuntimeError("index out of range");
         }
@@ -928,15 +1604,54 @@ ValueType ListTail::Evaluate(std::vector<NodePtr> args,
     throw RuntimeError("expected list in list-tail");
 }
 
-ValueType Eval::Evaluate(std::vector<NodePtr> args,
-                             std::shared_ptr<Scope> scope) {
+ValueType Eval::Evaluate(const ArgList& args,
+                             const std::shared_ptr<Scope>& scope) {
     if (args.size() != 1) {
         throw RuntimeError("expected 1 argument in eval");
     }
     auto func_value = args[0]->ComputeValue(scope);
     if (func_value.GetType() == ValueType::ValueEnum::FUNC){
-        auto func = func_value.GetValue<NodePtr>();
-        return func->ComputeValue(scope);
+        auto func = Resolver().Resolve(func_value.GetValue<NodePtr>());
+        return func->ComputeValue(GlobalScope(scope));
     }
     throw RuntimeError("not self evaluating");
 }
+
+void AddBuiltins(Scope* scope){
+    scope->AddName("+", ValueType(NodePtr(new Plus())));
+    scope->AddName("-", ValueType(NodePtr(new Minus())));
+    scope->AddName("*", ValueType(NodePtr(new Mult())));
+    scope->AddName("/", ValueType(NodePtr(new Div())));
+    scope->AddName("null?", ValueType(NodePtr(new NullPredicate())));
+    scope->AddName("pair?", ValueType(NodePtr(new PairPredicate())));
+    scope->AddName("number?", ValueType(NodePtr(new NumberPredicate())));
+    scope->AddName("boolean?", ValueType(NodePtr(new BoolPredicate())));
+    scope->AddName("symbol?", ValueType(NodePtr(new SymbolPredicate())));
+    scope->AddName("list?", ValueType(NodePtr(new ListPredicate())));
+    scope->AddName("eq?", ValueType(NodePtr(new EqPredicate())));
+    scope->AddName("equal?", ValueType(NodePtr(new EqualPredicate())));
+    scope->AddName("integer-equal?", ValueType(NodePtr(new IntEqualPredicate())));
+    scope->AddName("not", ValueType(NodePtr(new Not())));
+    scope->AddName("=", ValueType(NodePtr(new Equal())));
+    scope->AddName("<", ValueType(NodePtr(new Less())));
+    scope->AddName(">", ValueType(NodePtr(new More())));
+    scope->AddName("<=", ValueType(NodePtr(new LessEqual())));
+    scope->AddName(">=", ValueType(NodePtr(new MoreEqual())));
+    scope->AddName("min", ValueType(NodePtr(new Min())));
+    scope->AddName("max", ValueType(NodePtr(new Max())));
+    scope->AddName("abs", ValueType(NodePtr(new Abs())));
+    scope->AddName("cons", ValueType(NodePtr(new Cons())));
+    scope->AddName("car", ValueType(NodePtr(new Car())));
+    scope->AddName("cdr", ValueType(NodePtr(new Cdr())));
+    scope->AddName("set-car!", ValueType(NodePtr(new SetCar())));
+    scope->AddName("set-cdr!", ValueType(NodePtr(new SetCdr())));
+    scope->AddName("list", ValueType(NodePtr(new ListForm())));
+    scope->AddName("list-ref", ValueType(NodePtr(new ListRef())));
+    scope->AddName("list-tail", ValueType(NodePtr(new ListTail())));
+    scope->AddName("eval", ValueType(NodePtr(new Eval())));
+    scope->AddName("tier-stats", ValueType(NodePtr(new TierStatsForm())));
+    scope->AddName("tier-config", ValueType(NodePtr(new TierConfigForm())));
+    scope->AddName("gc-config", ValueType(NodePtr(new GcConfigForm())));
+    scope->AddName("gc-pauses", ValueType(NodePtr(new GcPausesForm())));
+    scope->AddName("heap-stats", ValueType(NodePtr(new HeapStatsForm())));
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -9,7 +10,7 @@
 class Empty : public ASTNode{
 public:
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
     std::string ToString() const override;
 };
 
@@ -17,61 +18,201 @@ class Const : public ASTNode{
 public:
     explicit Const(ValueType);
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
     std::string ToString() const override;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
 private:
     ValueType value_;
 };
 
 class Var : public ASTNode{
 public:
+    explicit Var(Symbol name);
     explicit Var(const std::string& name);
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
     std::string ToString() const override;
+    Symbol GetSymbol() const;
 
 private:
-    std::string name_;
+    Symbol name_;
+};
+
+// variable bound in a lambda frame, resolved to a slot by Resolver
+class LocalVar : public ASTNode{
+public:
+    LocalVar(Symbol name, size_t depth, size_t index);
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    std::string ToString() const override;
+    void Define(const std::shared_ptr<Scope>& scope, const ValueType& value);
+    void SetValue(const std::shared_ptr<Scope>& scope, const ValueType& value);
+    size_t Depth() const;
+    size_t Index() const;
+
+private:
+    Symbol name_;
+    size_t depth_;
+    size_t index_;
 };
 
 class Quote : public ASTNode{
 public:
     explicit Quote(NodePtr value);
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
     std::string ToString() const override;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
 
 private:
     NodePtr value_;
 };
 
+// expression in tail position left unevaluated by EvaluateTail
+struct TailCall {
+    NodePtr node;
+    std::shared_ptr<Scope> scope;
+};
+
+// evaluates node and then the tail calls it leaves in a loop, so they do
+// not grow the native stack
+ValueType RunTailCalls(ASTNode* node, const std::shared_ptr<Scope>& scope);
+
+class Pair;
+
+// pairs of a list made in one piece, such as a literal or the result of
+// list, in list order: pairs[i + 1] is the cdr of pairs[i], so a pair of
+// the run reaches any later one in a single step
+struct PairRun {
+    size_t ref_count;
+    GcVector<Pair*> pairs;
+};
+
+// car and cdr are tagged words, so integers and booleans in a list are
+// stored in the cell instead of in Const nodes of their own
 class Pair : public ASTNode{
 public:
     Pair() = default;
-    Pair(NodePtr first, NodePtr second);
+    Pair(ValueType car, ValueType cdr);
+    // a Const is stored as its value
+    Pair(const NodePtr& first, const NodePtr& second);
+    ~Pair() override;
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    ValueType EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) override;
     std::string ToString() const override;
-    std::vector<NodePtr> ToReverseVector() const;
+    // the elements followed by the last cdr
+    std::vector<ValueType> ToValues() const;
+    // ToValues with integers and booleans in Const nodes, for the resolver
     std::vector<NodePtr> ToVector() const;
     NodePtr Car() const;
     NodePtr Cdr() const;
-    void SetCar(NodePtr car);
-    void SetCdr(NodePtr cdr);
+    const ValueType& CarValue() const;
+    const ValueType& CdrValue() const;
+    void SetCar(ValueType car);
+    // leaves the run of the list if cdr is changed, splitting it
+    void SetCdr(ValueType cdr);
+    // the pair count cdrs further, null if the list ends before it
+    Pair* Tail(size_t count);
+    // the pair whose cdr is not a pair
+    Pair* Last();
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+private:
+    friend NodePtr ListFromValues(const std::vector<ValueType>& values, ValueType last);
+
+    ValueType car_;
+    ValueType cdr_;
+    PairRun* run_ = nullptr;
+    size_t run_index_ = 0;
+
+    void JoinRun(PairRun* run, size_t index);
+    void LeaveRun();
+    // pairs of the run after this one
+    size_t RunAhead() const;
+};
+
+// arguments of a call form, read in place from the call node
+class ArgList {
+public:
+    ArgList(const NodePtr* data, size_t size) : data_(data), size_(size) {}
+    explicit ArgList(const std::vector<NodePtr>& args) : data_(args.data()), size_(args.size()) {}
+    const NodePtr* begin() const { return data_; }
+    const NodePtr* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const NodePtr& operator[](size_t pos) const { return data_[pos]; }
+    const NodePtr& back() const { return data_[size_ - 1]; }
+
 private:
-    NodePtr car_;
-    NodePtr cdr_;
+    const NodePtr* data_;
+    size_t size_;
 };
 
+class ArgSpan {
+public:
+    ArgSpan(const ValueType* data, size_t size) : data_(data), size_(size) {}
+    const ValueType* begin() const { return data_; }
+    const ValueType* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const ValueType& operator[](size_t pos) const { return data_[pos]; }
+
+private:
+    const ValueType* data_;
+    size_t size_;
+};
+
+struct ClosureTail;
+
 class Func : public ASTNode{
 public:
     Func() = default;
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
-
-    virtual ValueType Evaluate(std::vector<NodePtr> args,
-                               std::shared_ptr<Scope> scope) = 0;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    Func* AsFunc() override;
+
+    virtual ValueType Evaluate(const ArgList& args,
+                               const std::shared_ptr<Scope>& scope) = 0;
+    // applies the function to evaluated arguments; a function made by
+    // ClosureCompiler may leave its body in *tail if tail is not null
+    virtual ValueType Call(ArgSpan args, const std::shared_ptr<Scope>& scope,
+                           ClosureTail* tail);
     std::string ToString() const override;
+    // true for functions closing over a frame: lambdas and their compiled
+    // forms
+    virtual bool IsClosure() const;
+    // calls of a closure and calls of it from its own body, reported by
+    // (tier-stats f); 0 for functions which are not counted
+    virtual size_t CallCount() const;
+    virtual size_t BackEdgeCount() const;
+};
+
+// function which may return its last expression unevaluated instead of
+// computing it; the caller then evaluates it in place of the call
+class TailFunc : public Func{
+public:
+    ValueType Evaluate(const ArgList& args,
+                       const std::shared_ptr<Scope>& scope) final;
+    virtual ValueType EvaluateTail(const ArgList& args,
+                                   const std::shared_ptr<Scope>& scope, TailCall* tail) = 0;
+};
+
+// builtin function which receives already evaluated arguments
+class Primitive : public Func{
+public:
+    ValueType Evaluate(const ArgList& args,
+                       const std::shared_ptr<Scope>& scope) override;
+    ValueType Call(ArgSpan args, const std::shared_ptr<Scope>& scope,
+                   ClosureTail* tail) override;
+    virtual ValueType Apply(ArgSpan args) = 0;
+};
+
+// primitive without side effects whose result depends only on the values
+// of its arguments, so calls with constant arguments may be folded
+class PurePrimitive : public Primitive{
 };
 
 class FuncList : public ASTNode{
@@ -79,44 +220,241 @@ public:
     FuncList() = default;
     explicit FuncList(const std::vector<NodePtr>& func_list);
     NodeType Type() const override;
-    ValueType ComputeValue(std::shared_ptr<Scope> scope) override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
     std::string ToString() const override;
+    const std::vector<NodePtr>& Elements() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
 
 private:
     std::vector<NodePtr> func_list_;
 };
 
-class Lambda : public Func{
+// resolved lambda expression: frame holds parameters first, then
+// names introduced by define in the body
+class LambdaExpr : public ASTNode{
+public:
+    LambdaExpr(std::vector<Symbol> names, size_t arity, NodePtr body);
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    std::string ToString() const override;
+    const std::vector<Symbol>& Names() const;
+    size_t Arity() const;
+    size_t FrameSize() const;
+    const FuncList& Body() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    std::vector<Symbol> names_;
+    size_t arity_;
+    NodePtr body_;
+};
+
+class JitCode;
+
+// once the calls or the back edges of the lambda reach JitThresholds() the
+// body is compiled to machine code if the platform supports it, see jit.h
+class Lambda : public TailFunc{
 public:
-    Lambda(std::vector<std::string> vars,
-           NodePtr func,
+    Lambda(size_t arity, size_t frame_size, NodePtr func,
            std::shared_ptr<Scope> inner_scope);
+    ~Lambda() override;
     NodeType Type() const override;
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+    ValueType EvaluateTail(const ArgList& args,
+                           const std::shared_ptr<Scope>& scope, TailCall* tail) override;
+    bool IsCompiled() const;
+    size_t CallCount() const override;
+    size_t BackEdgeCount() const override;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
 
 private:
-    friend class Lispp;
-    std::vector<std::string> vars_;
+    friend class JitCode;
+    friend class JitCompiler;
+    friend class CekMachine;
+    size_t arity_;
+    size_t frame_size_;
     NodePtr func_;
     std::shared_ptr<Scope> inner_scope_;
+    size_t call_count_ = 0;
+    size_t back_edge_count_ = 0;
+    bool promoted_ = false;
+    // owned; published with release order, since the background marker
+    // traces the constants of the code while the evaluator may compile it
+    std::atomic<JitCode*> jit_code_{nullptr};
+};
+
+// builtins with a fast path for two fixnum arguments
+enum class FixnumOp {
+    NONE, PLUS, MINUS, MULT, EQUAL, LESS, MORE, LESS_EQUAL, MORE_EQUAL
+};
+
+// FixnumOp::NONE unless func is one of the builtins above
+FixnumOp FixnumOpOf(Func* func);
+
+// computes op on two fixnums; false if an argument is not a fixnum or the
+// result overflows, then the builtin itself has to be applied
+inline bool ApplyFixnumOp(FixnumOp op, const ValueType& lhs, const ValueType& rhs,
+                          ValueType* result) {
+    if (!lhs.IsFixnum() || !rhs.IsFixnum()){
+        return false;
+    }
+    auto x = lhs.AsInt();
+    auto y = rhs.AsInt();
+    switch (op){
+        case FixnumOp::PLUS:
+            *result = ValueType(x + y);
+            return true;
+        case FixnumOp::MINUS:
+            *result = ValueType(x - y);
+            return true;
+        case FixnumOp::MULT: {
+            int64_t product;
+            if (__builtin_mul_overflow(x, y, &product)){
+                return false;
+            }
+            *result = ValueType(product);
+            return true;
+        }
+        case FixnumOp::EQUAL:
+            *result = ValueType(x == y);
+            return true;
+        case FixnumOp::LESS:
+            *result = ValueType(x < y);
+            return true;
+        case FixnumOp::MORE:
+            *result = ValueType(x > y);
+            return true;
+        case FixnumOp::LESS_EQUAL:
+            *result = ValueType(x <= y);
+            return true;
+        case FixnumOp::MORE_EQUAL:
+            *result = ValueType(x >= y);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// argument types a call site of a FixnumOp builtin has seen
+enum class TypeFeedback {
+    UNSEEN, FIXNUM, GENERIC
+};
+
+// function call; a callee bound to a global name is cached together with
+// the global binding version, so while no global binding changes the call
+// skips looking the name up and checking the callee. A cached call of an
+// arithmetic builtin with two arguments takes the fixnum path until an
+// argument of another type is seen, then the site stays generic.
+class CallExpr : public ASTNode{
+public:
+    CallExpr(NodePtr function, std::vector<NodePtr> args);
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    ValueType EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) override;
+    std::string ToString() const override;
+    const NodePtr& Function() const;
+    const std::vector<NodePtr>& Args() const;
+    TypeFeedback Feedback() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    NodePtr function_;
+    std::vector<NodePtr> args_;
+    uint64_t cache_version_ = 0;
+    Func* cached_func_ = nullptr;
+    TailFunc* cached_tail_func_ = nullptr;
+    FixnumOp fixnum_op_ = FixnumOp::NONE;
+    TypeFeedback feedback_ = TypeFeedback::UNSEEN;
+
+    ValueType EvaluateFixnum(const std::shared_ptr<Scope>& scope);
+};
+
+// call of pure builtins on constants computed ahead of time by
+// ConstantFolder; the value is used while every name the call depends on is
+// still bound to the builtin seen when folding, otherwise the original
+// expression is evaluated. For an if whose test was folded, taken is the
+// branch the test chose and is evaluated instead of the value.
+class FoldedExpr : public ASTNode{
+public:
+    FoldedExpr(ValueType value, std::vector<std::pair<Symbol, NodePtr>> guards,
+               NodePtr original, NodePtr taken = NodePtr());
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    ValueType EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) override;
+    std::string ToString() const override;
+    bool Holds(Scope* scope);
+    const ValueType& Value() const;
+    const std::vector<std::pair<Symbol, NodePtr>>& Guards() const;
+    const NodePtr& Original() const;
+    // null for a folded call
+    const NodePtr& Taken() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    ValueType value_;
+    std::vector<std::pair<Symbol, NodePtr>> guards_;
+    NodePtr original_;
+    NodePtr taken_;
+    uint64_t checked_version_ = 0;
 };
 
-class Define : public Func {
+// (if test consequent alternative), alternative may be null
+class IfExpr : public ASTNode{
 public:
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+    IfExpr(NodePtr test, NodePtr consequent, NodePtr alternative);
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    ValueType EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) override;
+    std::string ToString() const override;
+    const NodePtr& Test() const;
+    const NodePtr& Consequent() const;
+    const NodePtr& Alternative() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    NodePtr test_;
+    NodePtr consequent_;
+    NodePtr alternative_;
 };
 
-class Set : public Func{ValueType Evaluate(std::vector<NodePtr> args,
-                                           std::shared_ptr<Scope> scope) override ;
+// (define target value) or (set! target value), target is a Var or a LocalVar
+class AssignExpr : public ASTNode{
+public:
+    AssignExpr(bool is_define, NodePtr target, NodePtr value);
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    std::string ToString() const override;
+    const NodePtr& Target() const;
+    const NodePtr& Value() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    bool is_define_;
+    NodePtr target_;
+    NodePtr value_;
 };
 
-class LambdaForm : public Func{
+// (and args...) or (or args...)
+class LogicExpr : public ASTNode{
 public:
-    LambdaForm() = default;
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+    LogicExpr(bool is_and, std::vector<NodePtr> args);
+    NodeType Type() const override;
+    ValueType ComputeValue(const std::shared_ptr<Scope>& scope) override;
+    ValueType EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail) override;
+    std::string ToString() const override;
+    const std::vector<NodePtr>& Args() const;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    bool is_and_;
+    std::vector<NodePtr> args_;
 };
 
 bool IsNull(const ValueType& value);
@@ -129,186 +467,212 @@ bool IsInt(const ValueType& value);
 
 bool IsPair(const NodePtr& node);
 
+// the pair value holds, null if it holds none
+Pair* AsPair(const ValueType& value);
+
 bool IsList(const NodePtr& node);
 
 NodePtr NodeFromValue(ValueType value);
 
+ValueType ValueFromNode(const NodePtr& node);
+
+// node evaluating to an already computed argument value
+NodePtr NodeFromArgument(const ValueType& value);
+
 NodePtr ListFromVector(std::vector<NodePtr> elements);
 
-class Plus : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
-};
+NodePtr ListFromValues(const std::vector<ValueType>& values);
 
-class Minus : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+// list of values ending in last instead of the empty list, its pairs are
+// allocated contiguously and form one run
+NodePtr ListFromValues(const std::vector<ValueType>& values, ValueType last);
+
+class Plus : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Mult : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Minus : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Div : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Mult : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class QuoteForm : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Div : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class IfElse : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Not : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class And : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class NullPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Or : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class PairPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Not : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class NumberPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class NullPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class BoolPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class PairPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class SymbolPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class NumberPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class ListPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class BoolPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class EqualPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class SymbolPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class EqPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class ListPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class IntEqualPredicate : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class EqualPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Equal : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class EqPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class More : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class IntEqualPredicate : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Less : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Equal : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class MoreEqual : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class More : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class LessEqual : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Less : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Min : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class MoreEqual : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Max : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class LessEqual : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Abs : public PurePrimitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Min : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Cons : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Max : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Car : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Abs : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class Cdr : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Cons : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+class SetCar : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Car : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+
+class SetCdr : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class Cdr : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+
+class ListForm : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class SetCar : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+
+class ListRef : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
+class ListTail : public Primitive{
+    ValueType Apply(ArgSpan args) override;
+};
 
-class SetCdr : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+// (tier-stats) is an association list of the counters in jit.h, which the
+// tree walker keeps; (tier-stats f) the tier and counters of the lambda f,
+// which every evaluator keeps
+class TierStatsForm : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
+// (tier-config) is an association list of the thresholds of the
+// interpreter, (tier-config calls) sets the call threshold and
+// (tier-config calls back-edges) both; lambdas promoted already stay so
+class TierConfigForm : public Primitive{
+    ValueType Apply(ArgSpan args) override;
+};
 
-class ListForm : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+// objects of a heap by kind, its allocation totals and its collections;
+// garbage which has not been collected yet is counted as live
+struct HeapStats {
+    size_t pairs = 0;
+    size_t consts = 0;
+    size_t closures = 0;
+    size_t scopes = 0;
+    // syntax nodes, quotes, builtins and bytecode
+    size_t other = 0;
+    // bytes of the pooled blocks in use and of the chunks they come from
+    size_t live_bytes = 0;
+    size_t reserved_bytes = 0;
+    size_t bytes_allocated = 0;
+    size_t objects_allocated = 0;
+    // bytes allocated per second since the heap was created
+    size_t allocation_rate = 0;
+    size_t collections = 0;
+    size_t minor_collections = 0;
+    PauseHistogram pauses;
 };
 
+HeapStats MeasureHeap(const Heap& heap);
+
+// (heap-stats) is an association list of the HeapStats of the
+// interpreter's heap, pauses in microseconds
+class HeapStatsForm : public Primitive{
+    ValueType Apply(ArgSpan args) override;
+};
 
-class ListRef : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+// (gc-config) is an association list of the GcConfig of the interpreter's
+// heap, (gc-config max-pause-us) sets the longest step of a full
+// collection in microseconds, 0 collects the whole heap in one pause;
+// (gc-config max-pause-us concurrent) also chooses background marking
+class GcConfigForm : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
-class ListTail : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+// (gc-pauses) is the count, total and longest of the collection pauses in
+// microseconds and the nonempty buckets of their PauseHistogram as
+// (upper-bound-us . count), the last bound being 0 for unbounded
+class GcPausesForm : public Primitive{
+    ValueType Apply(ArgSpan args) override;
 };
 
 class Eval : public Func{
-    ValueType Evaluate(std::vector<NodePtr> args,
-                       std::shared_ptr<Scope> scope) override ;
+public:
+    ValueType Evaluate(const ArgList& args,
+                       const std::shared_ptr<Scope>& scope) override ;
 };
+
+// binds the builtin functions in the global scope
+void AddBuiltins(Scope* scope);
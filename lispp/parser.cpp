@@ -6,6 +6,8 @@ Parser::Parser() : tokenizer_(nullptr) {}
 Parser::Parser(std::shared_ptr<Tokenizer> tokenizer) : tokenizer_(std::move(tokenizer)) {}
 
 NodePtr Parser::Parse() {
+    auto heap = Heap::Current();
+    PoolArena arena(heap ? heap->Pool() : nullptr);
     tokenizer_->Consume();
     return Expression();
 }
@@ -13,32 +15,32 @@ NodePtr Parser::Parse() {
 NodePtr Parser::Expression() {
     auto token = tokenizer_->GetToken();
     if (token.GetType() == TokenType::NUMBER){
-        return std::make_shared<Const>(ValueType(StringToInt(token.GetString())));
+        return NodePtr(new Const(ValueType(StringToInt(token.GetString()))));
     }
     if (token.GetType() == TokenType::BOOL){
-        return std::make_shared<Const>(ValueType(StringToBool(token.GetString())));
+        return NodePtr(new Const(ValueType(StringToBool(token.GetString()))));
     }
     if (token.GetType() == TokenType::NAME){
-        return std::make_shared<Var>(token.GetString());
+        return NodePtr(new Var(Symbol::Intern(token.GetString())));
     }
     if (token.GetType() == TokenType::QUOTE){
         tokenizer_->Consume();
-        return std::make_shared<Quote>(Expression());
+        return NodePtr(new Quote(Expression()));
     }
     if (token.GetType() == TokenType::LEFT_PARENTHESES){
         tokenizer_->Consume();
         token = tokenizer_->GetToken();
         if (token.GetType() == TokenType::RIGHT_PARENTHESES) {
-            return std::make_shared<Empty>();
+            return NodePtr(new Empty());
         }
-        std::vector<NodePtr> elements;
-        elements.push_back(Expression());
+        std::vector<ValueType> elements;
+        elements.push_back(Element());
         tokenizer_->Consume();
         token = tokenizer_->GetToken();
         while (token.GetType() != TokenType::END &&
                 token.GetType() != TokenType::RIGHT_PARENTHESES &&
                 token.GetType() != TokenType::DOT){
-            elements.push_back(Expression());
+            elements.push_back(Element());
             tokenizer_->Consume();
             token = tokenizer_->GetToken();
         }
@@ -47,23 +49,29 @@ NodePtr Parser::Expression() {
         }
         if (token.GetType() == TokenType::DOT){
             tokenizer_->Consume();
-            elements.push_back(Expression());
+            elements.push_back(Element());
             tokenizer_->Consume();
             token = tokenizer_->GetToken();
             if (token.GetType() != TokenType::RIGHT_PARENTHESES) {
                 throw SyntaxError("invalid pair");
             }
         } else {
-            elements.push_back(std::make_shared<Empty>());
+            elements.push_back(ValueType(NodePtr(new Empty())));
         }
-        int it = elements.size() - 2;
-        auto pair = std::make_shared<Pair>(elements[it], elements.back());
-        --it;
-        while (it >= 0){
-            pair = std::make_shared<Pair>(elements[it], pair);
-            --it;
-        }
-        return pair;
+        auto last = std::move(elements.back());
+        elements.pop_back();
+        return ListFromValues(elements, std::move(last));
     }
     throw SyntaxError("unexpectable token " + token.GetString());
 }
+
+ValueType Parser::Element() {
+    auto token = tokenizer_->GetToken();
+    if (token.GetType() == TokenType::NUMBER){
+        return ValueType(StringToInt(token.GetString()));
+    }
+    if (token.GetType() == TokenType::BOOL){
+        return ValueType(StringToBool(token.GetString()));
+    }
+    return ValueType(Expression());
+}
@@ -7,9 +7,14 @@ class Parser{
 public:
     Parser();
     explicit Parser(std::shared_ptr<Tokenizer>);
+    // the nodes of a form are allocated contiguously from a PoolArena of
+    // the current heap
     NodePtr Parse();
     NodePtr Expression();
 
 private:
     std::shared_ptr<Tokenizer> tokenizer_;
+
+    // element of a list, numbers and booleans are stored in the pair itself
+    ValueType Element();
 };
\ No newline at end of file
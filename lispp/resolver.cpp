@@ -0,0 +1,206 @@
+#include "resolver.h"
+#include "exceptions.h"
+
+#include <algorithm>
+
+const Symbol kQuote = Symbol::Intern("quote");
+const Symbol kLambda = Symbol::Intern("lambda");
+const Symbol kDefine = Symbol::Intern("define");
+const Symbol kSet = Symbol::Intern("set!");
+const Symbol kIf = Symbol::Intern("if");
+const Symbol kAnd = Symbol::Intern("and");
+const Symbol kOr = Symbol::Intern("or");
+
+bool IsKeyword(const NodePtr& node, Symbol keyword){
+    return node->Type() == NodeType::VAR &&
+           static_cast<Var*>(node.get())->GetSymbol() == keyword;
+}
+
+bool IsSpecialFormName(Symbol name){
+    return name == kQuote || name == kLambda || name == kDefine || name == kSet ||
+           name == kIf || name == kAnd || name == kOr;
+}
+
+Symbol BindingName(const NodePtr& node){
+    if (node->Type() != NodeType::VAR){
+        throw SyntaxError("invalid function declaration");
+    }
+    auto name = static_cast<Var*>(node.get())->GetSymbol();
+    if (IsSpecialFormName(name)){
+        throw SyntaxError("special form " + name.Name() + " can not be redefined");
+    }
+    return name;
+}
+
+std::vector<Symbol> ParamNames(const NodePtr& decl){
+    std::vector<Symbol> names;
+    if (decl->Type() == NodeType::EMPTY){
+        return names;
+    }
+    if (!IsList(decl)){
+        throw SyntaxError("invalid function declaration");
+    }
+    auto vars = dynamic_cast<Pair*>(decl.get())->ToVector();
+    vars.pop_back();
+    for (auto& var : vars){
+        names.push_back(BindingName(var));
+    }
+    return names;
+}
+
+std::vector<NodePtr> FormElements(const NodePtr& node){
+    auto elements = dynamic_cast<Pair*>(node.get())->ToVector();
+    if (elements.back()->Type() != NodeType::EMPTY){
+        throw SyntaxError("dotted pair is not self evaluating");
+    }
+    elements.pop_back();
+    return elements;
+}
+
+NodePtr Resolver::Resolve(const NodePtr& node) {
+    frames_.clear();
+    return ResolveExpression(node);
+}
+
+NodePtr Resolver::ResolveExpression(const NodePtr& node) {
+    if (node->Type() == NodeType::VAR){
+        return ResolveVar(node);
+    }
+    if (node->Type() != NodeType::PAIR){
+        return node;
+    }
+    auto elements = FormElements(node);
+    auto head = elements.front();
+    std::vector<NodePtr> args(elements.begin() + 1, elements.end());
+    if (IsKeyword(head, kQuote)){
+        if (args.size() != 1){
+            throw SyntaxError("expected 1 argument in quote");
+        }
+        return NodePtr(new Quote(args[0]));
+    }
+    if (IsKeyword(head, kLambda)){
+        if (args.size() < 2){
+            throw SyntaxError("invalid lambda definition");
+        }
+        return ResolveLambda(args[0], std::vector<NodePtr>(args.begin() + 1, args.end()));
+    }
+    if (IsKeyword(head, kDefine)){
+        return ResolveDefine(args);
+    }
+    if (IsKeyword(head, kSet)){
+        return ResolveSet(args);
+    }
+    if (IsKeyword(head, kIf)){
+        return ResolveIf(args);
+    }
+    std::vector<NodePtr> resolved;
+    for (auto& arg : args){
+        resolved.push_back(ResolveExpression(arg));
+    }
+    if (IsKeyword(head, kAnd) || IsKeyword(head, kOr)){
+        return NodePtr(new LogicExpr(IsKeyword(head, kAnd), std::move(resolved)));
+    }
+    return NodePtr(new CallExpr(ResolveExpression(head), std::move(resolved)));
+}
+
+NodePtr Resolver::ResolveVar(const NodePtr& var) {
+    auto name = static_cast<Var*>(var.get())->GetSymbol();
+    for (size_t depth = 0; depth < frames_.size(); ++depth){
+        auto& frame = frames_[frames_.size() - depth - 1];
+        auto slot = std::find(frame.begin(), frame.end(), name);
+        if (slot != frame.end()){
+            return NodePtr(new LocalVar(name, depth, slot - frame.begin()));
+        }
+    }
+    return var;
+}
+
+NodePtr Resolver::ResolveDefine(const std::vector<NodePtr>& args) {
+    if (args.size() < 2){
+        throw SyntaxError("expected 2 arguments in define");
+    }
+    if (args[0]->Type() == NodeType::VAR){
+        if (args.size() != 2){
+            throw SyntaxError("expected 2 arguments in define");
+        }
+        BindingName(args[0]);
+        return NodePtr(new AssignExpr(true, ResolveVar(args[0]), ResolveExpression(args[1])));
+    }
+    if (args[0]->Type() == NodeType::PAIR){
+        auto decl = dynamic_cast<Pair*>(args[0].get());
+        BindingName(decl->Car());
+        auto lambda = ResolveLambda(decl->Cdr(),
+                                    std::vector<NodePtr>(args.begin() + 1, args.end()));
+        return NodePtr(new AssignExpr(true, ResolveVar(decl->Car()), lambda));
+    }
+    throw SyntaxError("invalid define syntax");
+}
+
+NodePtr Resolver::ResolveSet(const std::vector<NodePtr>& args) {
+    if (args.size() != 2){
+        throw SyntaxError("expected 2 arguments in set!");
+    }
+    if (args[0]->Type() != NodeType::VAR){
+        throw SyntaxError("expected variable name in set!");
+    }
+    BindingName(args[0]);
+    return NodePtr(new AssignExpr(false, ResolveVar(args[0]), ResolveExpression(args[1])));
+}
+
+NodePtr Resolver::ResolveIf(const std::vector<NodePtr>& args) {
+    if (! (args.size() == 2 || args.size() == 3)){
+        throw SyntaxError("expected 2 or 3 arguments in if");
+    }
+    NodePtr alternative;
+    if (args.size() == 3){
+        alternative = ResolveExpression(args[2]);
+    }
+    return NodePtr(new IfExpr(ResolveExpression(args[0]), ResolveExpression(args[1]),
+                              alternative));
+}
+
+NodePtr Resolver::ResolveLambda(const NodePtr& decl, const std::vector<NodePtr>& body) {
+    auto names = ParamNames(decl);
+    size_t arity = names.size();
+    for (auto& expression : body){
+        CollectDefines(expression, &names);
+    }
+    frames_.push_back(names);
+    std::vector<NodePtr> resolved;
+    for (auto& expression : body){
+        resolved.push_back(ResolveExpression(expression));
+    }
+    frames_.pop_back();
+    return NodePtr(new LambdaExpr(names, arity, NodePtr(new FuncList(resolved))));
+}
+
+void Resolver::CollectDefines(const NodePtr& node, std::vector<Symbol>* names) {
+    if (node->Type() != NodeType::PAIR || !IsList(node)){
+        return;
+    }
+    auto elements = dynamic_cast<Pair*>(node.get())->ToVector();
+    elements.pop_back();
+    auto& head = elements.front();
+    if (IsKeyword(head, kQuote) || IsKeyword(head, kLambda)){
+        return;
+    }
+    if (IsKeyword(head, kDefine) && elements.size() > 1){
+        auto target = elements[1];
+        bool is_function = target->Type() == NodeType::PAIR;
+        if (is_function){
+            target = dynamic_cast<Pair*>(target.get())->Car();
+        }
+        if (target->Type() == NodeType::VAR){
+            auto name = static_cast<Var*>(target.get())->GetSymbol();
+            if (std::find(names->begin(), names->end(), name) == names->end()){
+                names->push_back(name);
+            }
+        }
+        if (is_function){
+            return;
+        }
+    }
+    for (auto& element : elements){
+        CollectDefines(element, names);
+    }
+}
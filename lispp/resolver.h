@@ -0,0 +1,32 @@
+#pragma once
+
+#include "node_types.h"
+
+// symbols of the special forms
+extern const Symbol kQuote, kLambda, kDefine, kSet, kIf, kAnd, kOr;
+
+bool IsKeyword(const NodePtr& node, Symbol keyword);
+
+bool IsSpecialFormName(Symbol name);
+
+// Rewrites a parsed expression so that every variable bound by an
+// enclosing lambda becomes a LocalVar (frame depth, slot index) and every
+// lambda becomes a LambdaExpr with a known frame layout. Names not bound
+// lexically stay Var nodes and are looked up in the global scope. Other
+// special forms become Quote, IfExpr, AssignExpr and LogicExpr nodes and
+// function calls become CallExpr nodes.
+class Resolver{
+public:
+    NodePtr Resolve(const NodePtr& node);
+
+private:
+    std::vector<std::vector<Symbol>> frames_;
+
+    NodePtr ResolveExpression(const NodePtr& node);
+    NodePtr ResolveVar(const NodePtr& var);
+    NodePtr ResolveDefine(const std::vector<NodePtr>& args);
+    NodePtr ResolveSet(const std::vector<NodePtr>& args);
+    NodePtr ResolveIf(const std::vector<NodePtr>& args);
+    NodePtr ResolveLambda(const NodePtr& decl, const std::vector<NodePtr>& body);
+    void CollectDefines(const NodePtr& node, std::vector<Symbol>* names);
+};
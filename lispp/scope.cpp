@@ -1,69 +1,93 @@
 #include "scope.h"
 #include "exceptions.h"
 
-Scope::Scope() {
-    table_ = std::make_shared<std::unordered_map<std::string, ValueType>>();
+#include <algorithm>
+
+std::atomic<uint64_t> Scope::binding_version_{1};
+
+Scope::Scope() : table_(new GcVector<ValueType>()) {}
+
+Scope::Scope(std::shared_ptr<Scope> parent, size_t size, const Func* owner) :
+        parent_scope_(std::move(parent)), slots_(size), owner_(owner) {}
+
+Scope* Scope::TableScope() {
+    auto scope = this;
+    while (!scope->table_){
+        scope = scope->parent_scope_.get();
+    }
+    return scope;
 }
 
-Scope::Scope(std::shared_ptr<Scope> parent) : parent_scope_(std::move(parent)) {
-    table_ = std::make_shared<std::unordered_map<std::string, ValueType>>();
+void Scope::AddName(Symbol name, const ValueType& value) {
+    auto scope = TableScope();
+    auto& table = *scope->table_;
+    if (name.Id() >= table.size()){
+        // the ids of the process are shared by all interpreters, so the
+        // table grows only as far as the names this one binds
+        table.resize(std::max<size_t>(name.Id() + 1, table.size() * 2));
+    }
+    GcWriteBarrier(scope, table[name.Id()], value);
+    table[name.Id()] = value;
+    binding_version_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void Scope::AddName(const std::string& name, const ValueType& value) {
-    (*table_)[name] = value;
+    AddName(Symbol::Intern(name), value);
 }
 
-Scope *Scope::GetScope(const std::string &name) {
-    auto res = table_->find(name);
-    if (res != table_->end()){
-        return this;
-    }
-    auto scope = parent_scope_;
-    while (scope){
-        res = scope->table_->find(name);
-        if (res != scope->table_->end()){
-            return scope.get();
-        }
-        scope = scope->parent_scope_;
+ValueType* Scope::GetBinding(Symbol name) {
+    auto& table = *TableScope()->table_;
+    if (name.Id() < table.size() &&
+            table[name.Id()].GetType() != ValueType::ValueEnum::UNDEFINED){
+        return &table[name.Id()];
     }
     return nullptr;
 }
 
-ValueType Scope::GetValue(const std::string &name) {
-    auto scope = GetScope(name);
-    if (scope){
-        return (*scope->table_)[name];
+ValueType Scope::GetValue(Symbol name) {
+    auto binding = GetBinding(name);
+    if (binding){
+        return *binding;
     }
-    throw NameError("undefined name " + name);
+    throw NameError("undefined name " + name.Name());
 }
 
-void Scope::SetValue(const std::string &name, const ValueType &value) {
-    auto scope = GetScope(name);
-    if (scope){
-        (*scope->table_)[name] = value;
+void Scope::SetValue(Symbol name, const ValueType &value) {
+    auto binding = GetBinding(name);
+    if (binding){
+        GcWriteBarrier(TableScope(), *binding, value);
+        *binding = value;
+        binding_version_.fetch_add(1, std::memory_order_relaxed);
         return;
     }
-    throw NameError("undefined name " + name);
+    throw NameError("undefined name " + name.Name());
 }
 
-std::shared_ptr<Scope> ConcatScopes(std::shared_ptr<Scope> first, std::shared_ptr<Scope> second){
-    auto res = std::make_shared<Scope>();
-    auto copy = res;
-    auto scope = first;
-    copy->table_ = scope->table_;
-    while (scope->parent_scope_){
-        copy->parent_scope_ = std::make_shared<Scope>();
-        scope = scope->parent_scope_;
-        copy = copy->parent_scope_;
-        copy->table_ = scope->table_;
+void Scope::Trace(Tracer* tracer) {
+    TraceScope(tracer, parent_scope_);
+    for (auto& value : slots_){
+        TraceValue(tracer, value);
+    }
+    if (table_){
+        for (auto& value : *table_){
+            TraceValue(tracer, value);
+        }
     }
-    scope = second;
-    copy->table_ = scope->table_;
+}
+
+void Scope::ClearReferences() {
+    parent_scope_.reset();
+    for (auto& value : slots_){
+        value.Clear();
+    }
+    if (table_){
+        table_->clear();
+    }
+}
+
+std::shared_ptr<Scope> GlobalScope(std::shared_ptr<Scope> scope){
     while (scope->parent_scope_){
-        copy->parent_scope_ = std::make_shared<Scope>();
         scope = scope->parent_scope_;
-        copy = copy->parent_scope_;
-        copy->table_ = scope->table_;
     }
-    return res;
+    return scope;
 }
@@ -1,162 +1,498 @@
 #pragma once
 
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "common_functions.h"
+#include "gc.h"
+#include "symbol.h"
 
 class ValueType;
 class Scope;
+class Func;
+struct TailCall;
 
 enum class NodeType {
-    EMPTY, QUOTE, CONST, VAR, PAIR, LAMBDA, FUNC, FUNCLIST
+    EMPTY, QUOTE, CONST, VAR, LOCAL_VAR, PAIR, LAMBDA, LAMBDA_EXPR, FUNC, FUNCLIST,
+    CALL, FOLDED, IF, DEFINE, SET, AND, OR
 };
 
-class ASTNode{
+class ASTNode : public GcObject{
 public:
     ASTNode() = default;
-    virtual ~ASTNode() = default;
     virtual NodeType Type() const = 0;
-    virtual ValueType ComputeValue(std::shared_ptr<Scope> scope) = 0;
+    virtual ValueType ComputeValue(const std::shared_ptr<Scope>& scope) = 0;
+    // like ComputeValue, but may leave the expression in tail position
+    // unevaluated in *tail for the caller to evaluate in place of this one
+    virtual ValueType EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* tail);
     virtual std::string ToString() const = 0;
+    // this node as a function, null if it is not one
+    virtual Func* AsFunc() {
+        return nullptr;
+    }
+    size_t GcRefCount() const override {
+        return ref_count_;
+    }
+    void GcRetain() override;
+    void GcRelease() override;
+
+private:
+    friend void RetainNode(ASTNode* node);
+    friend void ReleaseNode(ASTNode* node);
+    friend bool IsUniqueNode(const ASTNode* node);
+    size_t ref_count_ = 0;
 };
 
-using NodePtr = std::shared_ptr<ASTNode>;
+inline void RetainNode(ASTNode* node) {
+    ++node->ref_count_;
+}
 
-// int64_t, bool, std::shared_ptr<ASTNode>
-class ValueType {
-public:
+inline bool IsUniqueNode(const ASTNode* node) {
+    return node->ref_count_ == 1;
+}
 
-    class InnerBase {
-    public:
-        virtual ~InnerBase() = default;
-        virtual InnerBase *Clone() const = 0;
-    };
+inline void ReleaseNode(ASTNode* node) {
+    if (--node->ref_count_ == 0) {
+        GcDelete(node);
+    }
+}
 
-    template <class T>
-    class Inner : public InnerBase {
-    public:
-        explicit Inner(T value) : value_(value) {}
+inline void ASTNode::GcRetain() {
+    RetainNode(this);
+}
 
-        InnerBase *Clone() const override {
-            return new Inner<T>(value_);
-        }
+inline void ASTNode::GcRelease() {
+    ReleaseNode(this);
+}
+
+// intrusive reference counted pointer to an AST node, so that a node can
+// also be owned by a single tagged word in ValueType
+template <class T>
+class Ref {
+public:
+    Ref() : ptr_(nullptr) {}
+
+    Ref(std::nullptr_t) : ptr_(nullptr) {}
 
-        T& operator*() {
-            return value_;
+    explicit Ref(T* ptr) : ptr_(ptr) {
+        if (ptr_) {
+            RetainNode(ptr_);
         }
+    }
+
+    Ref(const Ref& rhs) : Ref(rhs.ptr_) {}
+
+    Ref(Ref&& rhs) noexcept : ptr_(rhs.ptr_) {
+        rhs.ptr_ = nullptr;
+    }
 
-        const T& operator*() const {
-            return value_;
+    template <class U>
+    Ref(const Ref<U>& rhs) : Ref(rhs.get()) {}
+
+    ~Ref() {
+        if (ptr_) {
+            ReleaseNode(ptr_);
         }
-    private:
-        T value_;
-    };
+    }
+
+    Ref& operator=(Ref rhs) {
+        std::swap(ptr_, rhs.ptr_);
+        return *this;
+    }
+
+    void reset(T* ptr = nullptr) {
+        *this = Ref(ptr);
+    }
 
+    T* get() const {
+        return ptr_;
+    }
+
+    T* operator->() const {
+        return ptr_;
+    }
+
+    T& operator*() const {
+        return *ptr_;
+    }
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+private:
+    T* ptr_;
+};
+
+template <class T, class U>
+bool operator==(const Ref<T>& lhs, const Ref<U>& rhs) {
+    return lhs.get() == rhs.get();
+}
+
+template <class T, class U>
+bool operator!=(const Ref<T>& lhs, const Ref<U>& rhs) {
+    return lhs.get() != rhs.get();
+}
+
+using NodePtr = Ref<ASTNode>;
+
+// relaxed atomic access to a word which is otherwise accessed plainly, for
+// the words the background marker reads while the evaluator runs
+inline uintptr_t AtomicLoad(const uintptr_t* word) {
+#if defined(__GNUC__)
+    return __atomic_load_n(word, __ATOMIC_RELAXED);
+#else
+    return *static_cast<const volatile uintptr_t*>(word);
+#endif
+}
+
+inline void AtomicStore(uintptr_t* word, uintptr_t value) {
+#if defined(__GNUC__)
+    __atomic_store_n(word, value, __ATOMIC_RELAXED);
+#else
+    *static_cast<volatile uintptr_t*>(word) = value;
+#endif
+}
+
+// int64_t, bool or NodePtr packed into one tagged 64-bit word:
+//   ...1    fixnum, the integer shifted left by one bit
+//   ...000  pointer to an AST node, 0 is UNDEFINED
+//   ...010  boolean, bit 3 holds the value
+//   ...100  pointer to a boxed integer which does not fit a fixnum
+class ValueType {
+public:
     enum class ValueEnum {UNDEFINED, INT, BOOL, FUNC};
 
-    ValueType() : type_(ValueEnum::UNDEFINED){}
+    ValueType() : bits_(0) {}
 
+    explicit ValueType(bool value) : bits_(kBoolTag | (value ? kTrueBit : 0)) {}
 
-    template<class T>
-    explicit ValueType(const T &value) {
-        inner_ = std::make_shared<Inner<T>>(value);
-        SetType(value);
+    template <class T, class = typename std::enable_if<
+            std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+    explicit ValueType(T value) : bits_(EncodeInt(value)) {}
+
+    explicit ValueType(const NodePtr& node) : bits_(reinterpret_cast<uintptr_t>(node.get())) {
+        Retain();
     }
 
-    template<class T>
-    ValueType& operator=(const T &value) {
-        inner_.reset(new Inner<T>(value));
-        SetType(value);
-        return *this;
+    ValueType(const ValueType& rhs) : bits_(rhs.bits_) {
+        Retain();
     }
 
-    ValueType(const ValueType &rhs) : inner_(rhs.inner_->Clone()), type_(rhs.type_){}
+    ValueType(ValueType&& rhs) noexcept : bits_(rhs.bits_) {
+        rhs.bits_ = 0;
+    }
 
-    ValueType& operator=(const ValueType &rhs) {
+    ValueType& operator=(const ValueType& rhs) {
         ValueType temp(rhs);
         Swap(temp);
         return *this;
     }
 
-    ~ValueType() = default;
+    ValueType& operator=(ValueType&& rhs) noexcept {
+        Swap(rhs);
+        return *this;
+    }
+
+    template<class T>
+    ValueType& operator=(const T &value) {
+        ValueType temp(value);
+        Swap(temp);
+        return *this;
+    }
+
+    ~ValueType() {
+        Release();
+    }
 
     bool Empty() const {
-        if (inner_.get()) {
-            return true;
-        }
-        return false;
+        return bits_ != 0;
     }
 
     void Clear() {
-        inner_.reset();
-        type_ = ValueEnum::UNDEFINED;
+        Release();
+        bits_ = 0;
     }
 
     void Swap(ValueType &rhs) {
-        std::swap(rhs.inner_, inner_);
-        auto temp = rhs.type_;
-        rhs.type_ = type_;
-        type_ = temp;
+        std::swap(rhs.bits_, bits_);
     }
 
-    template<class T>
-    const T & GetValue() const {
-        return *dynamic_cast<Inner<T>&>(*inner_);
+    ValueEnum GetType() const {
+        if (bits_ & kFixnumTag) {
+            return ValueEnum::INT;
+        }
+        switch (bits_ & kTagMask) {
+            case kBoolTag:
+                return ValueEnum::BOOL;
+            case kBoxTag:
+                return ValueEnum::INT;
+            default:
+                return bits_ ? ValueEnum::FUNC : ValueEnum::UNDEFINED;
+        }
     }
 
-    ValueEnum GetType() const {
-        return type_;
+    bool IsInt() const {
+        return (bits_ & kFixnumTag) || (bits_ & kTagMask) == kBoxTag;
     }
 
-    std::string ToString() const {
-        if (type_ == ValueEnum::BOOL){
-            return BoolToString(GetValue<bool>());
-        }
-        if (type_ == ValueEnum::INT){
-            return IntToString(GetValue<int64_t >());
+    bool IsBool() const {
+        return (bits_ & kTagMask) == kBoolTag && !(bits_ & kFixnumTag);
+    }
+
+    bool IsFixnum() const {
+        return bits_ & kFixnumTag;
+    }
+
+    int64_t AsInt() const {
+        if (bits_ & kFixnumTag) {
+            return static_cast<int64_t>(bits_) >> 1;
         }
-        if (type_ == ValueEnum::FUNC){
-            return GetValue<NodePtr>()->ToString();
+        return Box()->value;
+    }
+
+    bool AsBool() const {
+        return bits_ & kTrueBit;
+    }
+
+    // tagged word, borrowed like AsNode
+    uintptr_t Bits() const {
+        return bits_;
+    }
+
+    // value holding its own reference to the word of another value
+    static ValueType FromBits(uintptr_t bits) {
+        ValueType value;
+        value.bits_ = bits;
+        value.Retain();
+        return value;
+    }
+
+    // The background marker of a concurrent collection reads the words of
+    // pairs and frame slots while the evaluator stores into them: it reads
+    // with LoadBits, and stores into such words are made with Store and Take.
+    uintptr_t LoadBits() const {
+        return AtomicLoad(&bits_);
+    }
+
+    // assignment by one atomic store of the word
+    void Store(ValueType value) {
+        auto old = bits_;
+        AtomicStore(&bits_, value.bits_);
+        // released together with value
+        value.bits_ = old;
+    }
+
+    // moves the value out, leaving UNDEFINED by one atomic store
+    ValueType Take() {
+        ValueType value;
+        value.bits_ = bits_;
+        AtomicStore(&bits_, 0);
+        return value;
+    }
+
+    // node a word points to, null if it holds none
+    static ASTNode* NodeOfBits(uintptr_t bits) {
+        return bits && (bits & kTagMask) == 0 ? reinterpret_cast<ASTNode*>(bits) : nullptr;
+    }
+
+    // borrowed pointer, valid while this value is alive
+    ASTNode* AsNode() const {
+        return reinterpret_cast<ASTNode*>(bits_);
+    }
+
+    template<class T>
+    T GetValue() const;
+
+    std::string ToString() const {
+        switch (GetType()) {
+            case ValueEnum::BOOL:
+                return BoolToString(AsBool());
+            case ValueEnum::INT:
+                return IntToString(AsInt());
+            case ValueEnum::FUNC:
+                return AsNode()->ToString();
+            default:
+                return "UNDEFINED";
         }
-        return "UNDEFINED";
     }
 
 private:
-    std::shared_ptr<InnerBase> inner_;
-    ValueEnum type_;
-    void SetType(const int64_t& value) {
-        type_ = ValueEnum::INT;
-    };
-    void SetType(const bool& value) {
-        type_ = ValueEnum::BOOL;
+    struct BoxedInt {
+        size_t ref_count;
+        int64_t value;
     };
-    void SetType(const NodePtr& value){
-        type_ = ValueEnum::FUNC;
-    };
-    template <class T>
-    void SetType(const T& value){
-        type_ = ValueEnum::UNDEFINED;
+
+    static constexpr uintptr_t kFixnumTag = 1;
+    static constexpr uintptr_t kTagMask = 7;
+    static constexpr uintptr_t kBoolTag = 2;
+    static constexpr uintptr_t kBoxTag = 4;
+    static constexpr uintptr_t kTrueBit = 8;
+    static constexpr int64_t kFixnumMax = INT64_MAX >> 1;
+    static constexpr int64_t kFixnumMin = INT64_MIN >> 1;
+
+    uintptr_t bits_;
+
+    static uintptr_t EncodeInt(int64_t value) {
+        if (value < kFixnumMin || value > kFixnumMax) {
+            return reinterpret_cast<uintptr_t>(new BoxedInt{1, value}) | kBoxTag;
+        }
+        return (static_cast<uintptr_t>(value) << 1) | kFixnumTag;
     }
 
+    BoxedInt* Box() const {
+        return reinterpret_cast<BoxedInt*>(bits_ & ~kTagMask);
+    }
+
+    void Retain() const {
+        if (bits_ & kFixnumTag) {
+            return;
+        }
+        if ((bits_ & kTagMask) == kBoxTag) {
+            ++Box()->ref_count;
+        } else if (bits_ && (bits_ & kTagMask) == 0) {
+            RetainNode(AsNode());
+        }
+    }
+
+    void Release() const {
+        if (bits_ & kFixnumTag) {
+            return;
+        }
+        if ((bits_ & kTagMask) == kBoxTag) {
+            if (--Box()->ref_count == 0) {
+                delete Box();
+            }
+        } else if (bits_ && (bits_ & kTagMask) == 0) {
+            ReleaseNode(AsNode());
+        }
+    }
 };
 
-class Scope{
+template<>
+inline int64_t ValueType::GetValue<int64_t>() const {
+    return AsInt();
+}
+
+template<>
+inline bool ValueType::GetValue<bool>() const {
+    return AsBool();
+}
+
+template<>
+inline NodePtr ValueType::GetValue<NodePtr>() const {
+    return NodePtr(AsNode());
+}
+
+inline ValueType ASTNode::EvaluateTail(const std::shared_ptr<Scope>& scope, TailCall* /*tail*/) {
+    return ComputeValue(scope);
+}
+
+// references held by a value or a node pointer, for GcObject::Trace
+inline void TraceValue(Tracer* tracer, const ValueType& value) {
+    if (auto node = ValueType::NodeOfBits(value.LoadBits())){
+        tracer->Visit(node);
+    }
+}
+
+inline void TraceNode(Tracer* tracer, const NodePtr& node) {
+    tracer->Visit(node.get());
+}
+
+// node held by value, null if it holds none
+inline GcObject* TracedNode(const ValueType& value) {
+    return value.GetType() == ValueType::ValueEnum::FUNC ? value.AsNode() : nullptr;
+}
+
+inline void GcWriteBarrier(GcObject* holder, const ValueType& old, const ValueType& value) {
+    GcWriteBarrier(holder, TracedNode(old), TracedNode(value));
+}
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) &&
+              ATOMIC_LLONG_LOCK_FREE == 2,
+              "JIT code reads the binding version as a plain word");
+
+// global scope keeps values in a table indexed by symbol id, lambda frames
+// keep fixed-size slot arrays addressed by (depth, index) from the resolver
+class Scope : public SharedGcObject<Scope>{
 public:
     Scope();
-    explicit Scope(std::shared_ptr<Scope> parent);
-    ValueType GetValue(const std::string& name);
+    // owner is the function whose call created the frame, if any
+    Scope(std::shared_ptr<Scope> parent, size_t size, const Func* owner = nullptr);
+    ValueType GetValue(Symbol name);
+    void AddName(Symbol name, const ValueType& value);
     void AddName(const std::string& name, const ValueType& value);
-    void SetValue(const std::string& name, const ValueType& value);
-    friend std::shared_ptr<Scope> ConcatScopes(std::shared_ptr<Scope> first, std::shared_ptr<Scope> second);
+    void SetValue(Symbol name, const ValueType& value);
+    // changes whenever a global binding of any interpreter is added or
+    // assigned, call sites use it to validate their cached callee. It is
+    // one atomic counter for the process: a change made by an interpreter
+    // on another thread only makes the caches check their callee again.
+    static uint64_t BindingVersion() {
+        return binding_version_.load(std::memory_order_relaxed);
+    }
+    // for machine code, which reads the counter with one aligned load
+    static const uint64_t* BindingVersionAddress() {
+        return reinterpret_cast<const uint64_t*>(&binding_version_);
+    }
+    // binding of a global name, null if the name is unbound
+    ValueType* GetBinding(Symbol name);
+    friend std::shared_ptr<Scope> GlobalScope(std::shared_ptr<Scope> scope);
+
+    ValueType& Slot(size_t depth, size_t index) {
+        auto scope = this;
+        for (; depth > 0; --depth){
+            scope = scope->parent_scope_.get();
+        }
+        return scope->slots_[index];
+    }
+
+    ValueType* Slots() {
+        return slots_.data();
+    }
+
+    // set! and define of a local: stores into a slot with the write barrier
+    void StoreSlot(size_t depth, size_t index, const ValueType& value) {
+        auto scope = this;
+        for (; depth > 0; --depth){
+            scope = scope->parent_scope_.get();
+        }
+        auto& slot = scope->slots_[index];
+        GcWriteBarrier(scope, slot, value);
+        slot.Store(value);
+    }
+
+    const Func* Owner() const {
+        return owner_;
+    }
+
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
 
 private:
-    friend class Lispp;
     std::shared_ptr<Scope> parent_scope_;
-    std::shared_ptr<std::unordered_map<std::string, ValueType>> table_;
-    Scope *GetScope(const std::string& name);
+    std::unique_ptr<GcVector<ValueType>> table_;
+    GcVector<ValueType> slots_;
+    const Func* owner_ = nullptr;
+    static std::atomic<uint64_t> binding_version_;
+
+    // the global scope this one is nested in
+    Scope* TableScope();
 };
 
+// scope allocated together with its control block from the current heap
+template <class... Args>
+std::shared_ptr<Scope> MakeScope(Args&&... args) {
+    return MakeShared<Scope>(std::forward<Args>(args)...);
+}
+
+inline void TraceScope(Tracer* tracer, const std::shared_ptr<Scope>& scope) {
+    tracer->Visit(scope.get());
+}
+
 
 
 
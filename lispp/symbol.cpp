@@ -0,0 +1,49 @@
+#include "symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+// shared by the interpreters of the process, which may run on different
+// threads, so every access takes the lock; names are never removed and a
+// deque keeps them in place, so Name() may return a reference
+struct SymbolTable {
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::deque<std::string> names;
+
+    SymbolTable() {
+        names.emplace_back();
+        ids.emplace("", 0);
+    }
+};
+
+static SymbolTable& Table() {
+    static SymbolTable table;
+    return table;
+}
+
+Symbol Symbol::Intern(const std::string& name) {
+    auto& table = Table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.ids.find(name);
+    if (it != table.ids.end()){
+        return Symbol(it->second);
+    }
+    uint32_t id = table.names.size();
+    table.names.push_back(name);
+    table.ids.emplace(name, id);
+    return Symbol(id);
+}
+
+uint32_t Symbol::Count() {
+    auto& table = Table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.names.size();
+}
+
+const std::string& Symbol::Name() const {
+    auto& table = Table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.names[id_];
+}
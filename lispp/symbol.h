@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// interned name: equal names share one id, so symbols compare as integers
+// and the global scope can index its bindings by id. The table is one per
+// process and is locked, so interpreters on different threads may intern
+// at the same time; like the symbols of a Lisp image, interned names are
+// kept until the process exits.
+class Symbol{
+public:
+    Symbol() : id_(0) {}
+    static Symbol Intern(const std::string& name);
+    // number of symbols interned so far, all ids are below it
+    static uint32_t Count();
+
+    const std::string& Name() const;
+    uint32_t Id() const { return id_; }
+
+    bool operator==(Symbol rhs) const { return id_ == rhs.id_; }
+    bool operator!=(Symbol rhs) const { return id_ != rhs.id_; }
+
+private:
+    explicit Symbol(uint32_t id) : id_(id) {}
+    uint32_t id_;
+};
+
+namespace std {
+template <>
+struct hash<Symbol> {
+    size_t operator()(Symbol symbol) const {
+        return symbol.Id();
+    }
+};
+}
@@ -0,0 +1,275 @@
+#include "vm.h"
+#include "exceptions.h"
+
+namespace {
+// entries of a stack kept after a failed run, larger stacks are freed
+const size_t kKeptStackSize = 1024;
+}
+
+Closure::Closure(std::shared_ptr<CodeObject> code, std::shared_ptr<Scope> scope, VM* vm) :
+        code_(std::move(code)), scope_(std::move(scope)), vm_(vm) {}
+
+NodeType Closure::Type() const {
+    return NodeType::LAMBDA;
+}
+
+size_t Closure::CallCount() const {
+    return call_count_;
+}
+
+size_t Closure::BackEdgeCount() const {
+    return back_edge_count_;
+}
+
+void Closure::Trace(Tracer* tracer) {
+    TraceScope(tracer, scope_);
+    tracer->Visit(code_.get());
+}
+
+void Closure::ClearReferences() {
+    scope_.reset();
+    code_.reset();
+}
+
+ValueType Closure::Evaluate(const ArgList& args,
+                            const std::shared_ptr<Scope>& scope) {
+    std::vector<ValueType> values;
+    values.reserve(args.size());
+    for (auto& arg : args){
+        values.push_back(arg->ComputeValue(scope));
+    }
+    return vm_->Call(this, ArgSpan(values.data(), values.size()));
+}
+
+std::shared_ptr<Scope> VM::BindArguments(Closure* closure, ArgSpan args){
+    auto& code = *closure->code_;
+    if (args.size() != code.arity){
+        throw RuntimeError("wrong number of arguments in function call");
+    }
+    ++closure->call_count_;
+    auto scope = MakeScope(closure->scope_, code.frame_size, closure);
+    for (size_t i = 0; i < args.size(); ++i){
+        scope->Slot(0, i) = args[i];
+    }
+    return scope;
+}
+
+ValueType& BoundSlot(const CodeObject& code, const Instruction& instruction,
+                     const std::shared_ptr<Scope>& scope){
+    auto& value = scope->Slot(instruction.depth, instruction.slot);
+    if (value.GetType() == ValueType::ValueEnum::UNDEFINED){
+        throw NameError("undefined name " + code.names[instruction.arg]);
+    }
+    return value;
+}
+
+VM::VM() : empty_(NodePtr(new Empty())) {}
+
+ValueType VM::Run(std::shared_ptr<CodeObject> code, std::shared_ptr<Scope> scope) {
+    size_t entry_depth = frames_.size();
+    size_t stack_size = stack_.size();
+    frames_.push_back({std::move(code), 0, std::move(scope), stack_size});
+    try {
+        return Execute(entry_depth);
+    } catch (...) {
+        Unwind(entry_depth, stack_size);
+        ReleaseStacks();
+        throw;
+    }
+}
+
+ValueType VM::Call(Closure* closure, ArgSpan args) {
+    return Run(closure->code_, BindArguments(closure, args));
+}
+
+void VM::TraceRoots(Tracer* tracer) const {
+    for (auto& value : stack_){
+        TraceValue(tracer, value);
+    }
+    for (auto& frame : frames_){
+        tracer->Visit(frame.code.get());
+        TraceScope(tracer, frame.scope);
+    }
+    TraceValue(tracer, empty_);
+}
+
+ValueType VM::Execute(size_t entry_depth) {
+    while (true) {
+        auto& frame = frames_.back();
+        auto& instruction = frame.code->code[frame.pc++];
+        switch (instruction.op) {
+            case OpCode::CONST:
+                stack_.push_back(frame.code->constants[instruction.arg]);
+                break;
+            case OpCode::FOLDED: {
+                auto folded = static_cast<FoldedExpr*>(frame.code->constants[instruction.arg].AsNode());
+                if (folded->Holds(frame.scope.get())){
+                    stack_.push_back(folded->Value());
+                } else {
+                    ++frame.pc;
+                }
+                break;
+            }
+            case OpCode::LOAD_LOCAL:
+                stack_.push_back(BoundSlot(*frame.code, instruction, frame.scope));
+                break;
+            case OpCode::DEFINE_LOCAL:
+                frame.scope->StoreSlot(instruction.depth, instruction.slot, stack_.back());
+                stack_.back() = empty_;
+                break;
+            case OpCode::SET_LOCAL:
+                BoundSlot(*frame.code, instruction, frame.scope);
+                frame.scope->StoreSlot(instruction.depth, instruction.slot, stack_.back());
+                stack_.back() = empty_;
+                break;
+            case OpCode::LOAD_GLOBAL:
+                stack_.push_back(frame.scope->GetValue(frame.code->globals[instruction.arg]));
+                break;
+            case OpCode::DEFINE_GLOBAL:
+                frame.scope->AddName(frame.code->globals[instruction.arg], stack_.back());
+                stack_.back() = empty_;
+                break;
+            case OpCode::SET_GLOBAL:
+                frame.scope->SetValue(frame.code->globals[instruction.arg], stack_.back());
+                stack_.back() = empty_;
+                break;
+            case OpCode::POP:
+                stack_.pop_back();
+                break;
+            case OpCode::JUMP:
+                frame.pc = instruction.arg;
+                break;
+            case OpCode::JUMP_IF_FALSE: {
+                bool condition = IsTrue(stack_.back());
+                stack_.pop_back();
+                if (!condition){
+                    frame.pc = instruction.arg;
+                }
+                break;
+            }
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+                if (IsTrue(stack_.back())){
+                    stack_.pop_back();
+                } else {
+                    frame.pc = instruction.arg;
+                }
+                break;
+            case OpCode::JUMP_IF_TRUE_OR_POP:
+                if (IsTrue(stack_.back())){
+                    frame.pc = instruction.arg;
+                } else {
+                    stack_.pop_back();
+                }
+                break;
+            case OpCode::MAKE_CLOSURE:
+                stack_.push_back(ValueType(NodePtr(
+                        new Closure(frame.code->functions[instruction.arg], frame.scope, this))));
+                break;
+            case OpCode::CALL:
+                CallValue(instruction.arg, false);
+                break;
+            case OpCode::TAIL_CALL:
+                CallValue(instruction.arg, true);
+                break;
+            case OpCode::RETURN: {
+                auto value = stack_.back();
+                if (PopFrame(value, entry_depth)){
+                    return value;
+                }
+                break;
+            }
+            case OpCode::RAISE:
+                throw RuntimeError(frame.code->names[instruction.arg]);
+        }
+    }
+}
+
+void VM::CallValue(size_t argc, bool tail) {
+    GcSafepoint();
+    size_t callee_pos = stack_.size() - argc - 1;
+    if (stack_[callee_pos].GetType() != ValueType::ValueEnum::FUNC){
+        throw RuntimeError(stack_[callee_pos].ToString() + " is not self evaluating");
+    }
+    auto callee = stack_[callee_pos].GetValue<NodePtr>();
+    ArgSpan args(stack_.data() + callee_pos + 1, argc);
+
+    if (auto closure = dynamic_cast<Closure*>(callee.get())){
+        if (frames_.back().scope->Owner() == closure){
+            ++closure->back_edge_count_;
+        }
+        auto scope = BindArguments(closure, args);
+        stack_.erase(stack_.begin() + callee_pos, stack_.end());
+        PushFrame(closure->code_, std::move(scope), callee_pos, tail);
+        return;
+    }
+    if (auto primitive = dynamic_cast<Primitive*>(callee.get())){
+        auto result = primitive->Apply(args);
+        stack_.erase(stack_.begin() + callee_pos, stack_.end());
+        stack_.push_back(std::move(result));
+        return;
+    }
+    if (dynamic_cast<Eval*>(callee.get())){
+        if (argc != 1) {
+            throw RuntimeError("expected 1 argument in eval");
+        }
+        if (args[0].GetType() != ValueType::ValueEnum::FUNC){
+            throw RuntimeError("not self evaluating");
+        }
+        auto code = compiler_.Compile(resolver_.Resolve(args[0].GetValue<NodePtr>()));
+        stack_.erase(stack_.begin() + callee_pos, stack_.end());
+        PushFrame(std::move(code), GlobalScope(frames_.back().scope), callee_pos, tail);
+        return;
+    }
+    auto func = callee->AsFunc();
+    if (!func){
+        throw RuntimeError(callee->ToString() + " is not self evaluating");
+    }
+    std::vector<NodePtr> nodes;
+    for (auto& arg : args){
+        nodes.push_back(NodeFromArgument(arg));
+    }
+    auto scope = frames_.back().scope;
+    auto result = func->Evaluate(ArgList(nodes), scope);
+    stack_.erase(stack_.begin() + callee_pos, stack_.end());
+    stack_.push_back(std::move(result));
+}
+
+void VM::PushFrame(std::shared_ptr<CodeObject> code, std::shared_ptr<Scope> scope,
+                   size_t base, bool tail) {
+    if (tail){
+        auto& frame = frames_.back();
+        stack_.erase(stack_.begin() + frame.base, stack_.end());
+        frame.code = std::move(code);
+        frame.pc = 0;
+        frame.scope = std::move(scope);
+        return;
+    }
+    frames_.push_back({std::move(code), 0, std::move(scope), base});
+}
+
+bool VM::PopFrame(ValueType value, size_t entry_depth) {
+    stack_.erase(stack_.begin() + frames_.back().base, stack_.end());
+    frames_.pop_back();
+    if (frames_.size() == entry_depth){
+        return true;
+    }
+    stack_.push_back(std::move(value));
+    return false;
+}
+
+void VM::Unwind(size_t entry_depth, size_t stack_size) {
+    frames_.erase(frames_.begin() + entry_depth, frames_.end());
+    stack_.erase(stack_.begin() + stack_size, stack_.end());
+}
+
+void VM::ReleaseStacks() {
+    if (!frames_.empty() || !stack_.empty()){
+        return;
+    }
+    if (stack_.capacity() > kKeptStackSize){
+        stack_.shrink_to_fit();
+    }
+    if (frames_.capacity() > kKeptStackSize){
+        frames_.shrink_to_fit();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "compiler.h"
+#include "resolver.h"
+
+class VM;
+
+class Closure : public Func{
+public:
+    Closure(std::shared_ptr<CodeObject> code, std::shared_ptr<Scope> scope, VM* vm);
+    NodeType Type() const override;
+    ValueType Evaluate(const ArgList& args,
+                       const std::shared_ptr<Scope>& scope) override;
+    size_t CallCount() const override;
+    size_t BackEdgeCount() const override;
+    void Trace(Tracer* tracer) override;
+    void ClearReferences() override;
+
+private:
+    friend class VM;
+    std::shared_ptr<CodeObject> code_;
+    std::shared_ptr<Scope> scope_;
+    VM* vm_;
+    size_t call_count_ = 0;
+    size_t back_edge_count_ = 0;
+};
+
+class VM{
+public:
+    VM();
+    ValueType Run(std::shared_ptr<CodeObject> code, std::shared_ptr<Scope> scope);
+    ValueType Call(Closure* closure, ArgSpan args);
+    // values and frames of the running code, roots of the collector
+    void TraceRoots(Tracer* tracer) const;
+
+private:
+    struct Frame {
+        std::shared_ptr<CodeObject> code;
+        size_t pc;
+        std::shared_ptr<Scope> scope;
+        size_t base;
+    };
+
+    // count against the memory limit, so deep recursion is bounded by it
+    GcVector<ValueType> stack_;
+    GcVector<Frame> frames_;
+    Resolver resolver_;
+    Compiler compiler_;
+    ValueType empty_;
+
+    // frame of a call of closure, counted in its call count
+    static std::shared_ptr<Scope> BindArguments(Closure* closure, ArgSpan args);
+    ValueType Execute(size_t entry_depth);
+    void CallValue(size_t argc, bool tail);
+    void PushFrame(std::shared_ptr<CodeObject> code, std::shared_ptr<Scope> scope,
+                   size_t base, bool tail);
+    bool PopFrame(ValueType value, size_t entry_depth);
+    void Unwind(size_t entry_depth, size_t stack_size);
+    // frees the stacks grown by deep recursion once the outermost run fails,
+    // which may have stopped at the memory limit
+    void ReleaseStacks();
+};
@@ -0,0 +1,19 @@
+(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))
+(fact 20)
+(define (count-down n) (if (= n 0) 'done (count-down (- n 1))))
+(count-down 1000000)
+(define (counter) (define n 0) (lambda () (set! n (+ n 1)) n))
+(define c (counter))
+(c)
+(c)
+'(a b . c)
+(and 1 (or #f 2))
+(car '(x y))
+undefined-name
+(eval '(+ 1 2))
+((lambda (f) (f 3)) (lambda (x) (* x x)))
+(define (even? n) (if (= n 0) #t (odd? (- n 1))))
+(define (odd? n) (if (= n 0) #f (even? (- n 1))))
+(even? 100001)
+(define (spin n) (define (f) n) (if (= n 0) 'done (spin (- n 1))))
+(spin 1000000)
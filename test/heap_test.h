@@ -0,0 +1,24 @@
+#pragma once
+
+#include <catch.hpp>
+#include <lispp/lispp.h>
+#include <lispp/exceptions.h>
+
+// global scope with the builtins in a heap of its own, for tests which run
+// an evaluator directly instead of through Lispp; like ~Lispp the
+// destructor collects the cycles between the scope and its closures
+struct HeapTest {
+
+    Heap heap;
+    HeapScope heap_scope;
+    std::shared_ptr<Scope> scope;
+
+    HeapTest() : heap_scope(&heap), scope(MakeScope()) {
+        AddBuiltins(scope.get());
+    }
+
+    ~HeapTest() {
+        scope.reset();
+        heap.Collect();
+    }
+};
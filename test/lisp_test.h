@@ -4,13 +4,19 @@
 #include <lispp/lispp.h>
 #include <lispp/exceptions.h>
 
+#ifndef LISP_TEST_MODE
+#define LISP_TEST_MODE EvalMode::BYTECODE
+#endif
+
 struct LispTest {
 
     Lispp lisp;
     std::stringstream in;
     std::stringstream out;
 
-    LispTest() : lisp(&in, &out) {}
+    explicit LispTest(GcConfig gc_config = GcConfig(),
+                      TierThresholds tier_thresholds = TierThresholds()) :
+            lisp(&in, &out, LISP_TEST_MODE, gc_config, tier_thresholds) {}
 
     void ExpectEq(std::string expression, std::string expected) {
         in.clear();
@@ -47,6 +53,7 @@ struct LispTest {
             while (in.peek() != EOF) {
                 lisp.Run();
             }
+            CHECK(false);
         } catch(const SyntaxError& err){
             CHECK(true);
         } catch (const std::exception& err){
@@ -64,6 +71,7 @@ struct LispTest {
             while (in.peek() != EOF) {
                 lisp.Run();
             }
+            CHECK(false);
         } catch(const RuntimeError& err){
             CHECK(true);
         } catch (const std::exception& err){
@@ -81,6 +89,7 @@ struct LispTest {
             while (in.peek() != EOF) {
                 lisp.Run();
             }
+            CHECK(false);
         } catch(const NameError& err){
             CHECK(true);
         } catch (const std::exception& err){
@@ -2,6 +2,7 @@
 
 #include <catch.hpp>
 #include <lispp/parser.h>
+#include <lispp/resolver.h>
 #include <lispp/exceptions.h>
 #include <lispp/scope.h>
 #include <iostream>
@@ -17,35 +18,28 @@ struct ParserTest {
         tokenizer = std::make_shared<Tokenizer>(&in);
         parser = std::make_shared<Parser>(tokenizer);
         global_scope = std::make_shared<Scope>();
-        global_scope->AddName("define", ValueType(std::shared_ptr<ASTNode>(new Define())));
-        global_scope->AddName("lambda", ValueType(std::shared_ptr<ASTNode>(new LambdaForm())));
-        global_scope->AddName("+", ValueType(std::shared_ptr<ASTNode>(new Plus())));
-        global_scope->AddName("-", ValueType(std::shared_ptr<ASTNode>(new Minus())));
-        global_scope->AddName("*", ValueType(std::shared_ptr<ASTNode>(new Mult())));
-        global_scope->AddName("/", ValueType(std::shared_ptr<ASTNode>(new Div())));
-        global_scope->AddName("set!", ValueType(std::shared_ptr<ASTNode>(new Set())));
-        global_scope->AddName("if", ValueType(std::shared_ptr<ASTNode>(new IfElse())));
-        global_scope->AddName("quote", ValueType(std::shared_ptr<ASTNode>(new QuoteForm())));
-        global_scope->AddName("and", ValueType(std::shared_ptr<ASTNode>(new And())));
-        global_scope->AddName("or", ValueType(std::shared_ptr<ASTNode>(new Or())));
-        global_scope->AddName("null?", ValueType(std::shared_ptr<ASTNode>(new NullPredicate())));
-        global_scope->AddName("pair?", ValueType(std::shared_ptr<ASTNode>(new PairPredicate())));
-        global_scope->AddName("number?", ValueType(std::shared_ptr<ASTNode>(new NumberPredicate())));
-        global_scope->AddName("boolean?", ValueType(std::shared_ptr<ASTNode>(new BoolPredicate())));
-        global_scope->AddName("symbol?", ValueType(std::shared_ptr<ASTNode>(new SymbolPredicate())));
-        global_scope->AddName("list?", ValueType(std::shared_ptr<ASTNode>(new ListPredicate())));
-        global_scope->AddName("eq?", ValueType(std::shared_ptr<ASTNode>(new EqualPredicate())));
-        global_scope->AddName("equal?", ValueType(std::shared_ptr<ASTNode>(new EqPredicate())));
-        global_scope->AddName("integer-equal?", ValueType(std::shared_ptr<ASTNode>(new IntEqualPredicate())));
-        global_scope->AddName("not", ValueType(std::shared_ptr<ASTNode>(new Not())));
-        global_scope->AddName("=", ValueType(std::shared_ptr<ASTNode>(new Equal())));
-        global_scope->AddName("<", ValueType(std::shared_ptr<ASTNode>(new Less())));
-        global_scope->AddName(">", ValueType(std::shared_ptr<ASTNode>(new More())));
-        global_scope->AddName("<=", ValueType(std::shared_ptr<ASTNode>(new LessEqual())));
-        global_scope->AddName(">=", ValueType(std::shared_ptr<ASTNode>(new MoreEqual())));
-        global_scope->AddName("min", ValueType(std::shared_ptr<ASTNode>(new Min())));
-        global_scope->AddName("max", ValueType(std::shared_ptr<ASTNode>(new Max())));
-        global_scope->AddName("abs", ValueType(std::shared_ptr<ASTNode>(new Abs())));
+        global_scope->AddName("+", ValueType(NodePtr(new Plus())));
+        global_scope->AddName("-", ValueType(NodePtr(new Minus())));
+        global_scope->AddName("*", ValueType(NodePtr(new Mult())));
+        global_scope->AddName("/", ValueType(NodePtr(new Div())));
+        global_scope->AddName("null?", ValueType(NodePtr(new NullPredicate())));
+        global_scope->AddName("pair?", ValueType(NodePtr(new PairPredicate())));
+        global_scope->AddName("number?", ValueType(NodePtr(new NumberPredicate())));
+        global_scope->AddName("boolean?", ValueType(NodePtr(new BoolPredicate())));
+        global_scope->AddName("symbol?", ValueType(NodePtr(new SymbolPredicate())));
+        global_scope->AddName("list?", ValueType(NodePtr(new ListPredicate())));
+        global_scope->AddName("eq?", ValueType(NodePtr(new EqualPredicate())));
+        global_scope->AddName("equal?", ValueType(NodePtr(new EqPredicate())));
+        global_scope->AddName("integer-equal?", ValueType(NodePtr(new IntEqualPredicate())));
+        global_scope->AddName("not", ValueType(NodePtr(new Not())));
+        global_scope->AddName("=", ValueType(NodePtr(new Equal())));
+        global_scope->AddName("<", ValueType(NodePtr(new Less())));
+        global_scope->AddName(">", ValueType(NodePtr(new More())));
+        global_scope->AddName("<=", ValueType(NodePtr(new LessEqual())));
+        global_scope->AddName(">=", ValueType(NodePtr(new MoreEqual())));
+        global_scope->AddName("min", ValueType(NodePtr(new Min())));
+        global_scope->AddName("max", ValueType(NodePtr(new Max())));
+        global_scope->AddName("abs", ValueType(NodePtr(new Abs())));
         global_scope->AddName("cons", ValueType(NodePtr(new Cons())));
         global_scope->AddName("car", ValueType(NodePtr(new Car())));
         global_scope->AddName("cdr", ValueType(NodePtr(new Cdr())));
@@ -60,7 +54,7 @@ struct ParserTest {
     void ExpectEqual(std::string expression, std::string expected) {
         in.clear();
         in.str(expression);
-        auto node = parser->Parse();
+        auto node = Resolver().Resolve(parser->Parse());
         ValueType res_value = node->ComputeValue(global_scope);
         CHECK(res_value.ToString() == expected);
     }
@@ -69,7 +63,7 @@ struct ParserTest {
         in.clear();
         in.str(expression);
         try {
-            auto node = parser->Parse();
+            auto node = Resolver().Resolve(parser->Parse());
             ValueType res_value = node->ComputeValue(global_scope);
             CHECK(true);
         } catch (const std::exception& err){
@@ -82,7 +76,7 @@ struct ParserTest {
         in.clear();
         in.str(expression);
         try {
-            auto node = parser->Parse();
+            auto node = Resolver().Resolve(parser->Parse());
             ValueType res_value = node->ComputeValue(global_scope);
             CHECK(false);
         } catch(const NameError& err){
@@ -98,7 +92,7 @@ struct ParserTest {
         in.str(expression);
         try {
             while (!in.eof()) {
-                auto node = parser->Parse();
+                auto node = Resolver().Resolve(parser->Parse());
                 ValueType res_value = node->ComputeValue(global_scope);
             }
             CHECK(false);
@@ -115,7 +109,7 @@ struct ParserTest {
         in.str(expression);
         try {
             while (!in.eof()) {
-                auto node = parser->Parse();
+                auto node = Resolver().Resolve(parser->Parse());
                 ValueType res_value = node->ComputeValue(global_scope);
             }
             CHECK(false);
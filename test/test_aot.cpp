@@ -0,0 +1,55 @@
+#include "lisp_test.h"
+#include "heap_test.h"
+#include <lispp/aot.h>
+#include <lispp/cpp_emitter.h>
+
+#include <fstream>
+
+// output of the interpreter for test/aot_example.lisp
+static std::string InterpretedExample() {
+    std::ifstream source(AOT_EXAMPLE_PATH);
+    std::stringstream in;
+    in << source.rdbuf();
+    std::stringstream expected;
+    Lispp lisp(&in, &expected);
+    while ((in >> std::ws).peek() != EOF){
+        try {
+            lisp.Run();
+        } catch (const std::exception& exception){
+            expected << "     >> " << exception.what() << std::endl;
+        }
+    }
+    return expected.str();
+}
+
+// CompiledProgram comes from test/aot_example.lisp translated by
+// lispp --compile at build time
+TEST_CASE("CompiledProgramMatchesInterpreter") {
+    auto expected = InterpretedExample();
+
+    HeapTest heap_test;
+    std::stringstream out;
+    CompiledProgram(heap_test.scope, &out);
+    CHECK(out.str() == expected);
+}
+
+TEST_CASE("CompiledProgramCollectsCycles") {
+    auto expected = InterpretedExample();
+
+    // every iteration of spin leaves a closure and its frame in a cycle,
+    // which would exceed the limit unless the compiled loop collects them
+    GcConfig config;
+    config.memory_limit = 20 << 20;
+    std::stringstream out;
+    CHECK(RunCompiledProgram(&out, config) == 0);
+    CHECK(out.str() == expected);
+}
+
+TEST_CASE("EmitterTranslatesTailCalls") {
+    std::stringstream in("(define (f x) (if x (g x) (+ x 1)))");
+    auto source = CompileToCpp(&in);
+    CHECK(source.find("AotTail(tail, {AotGlobal(scope, symbol_0), "
+                      "AotLocal(scope, 0, 0, \"x\")})") != std::string::npos);
+    CHECK(source.find("AotDefineGlobal(scope, symbol_2, AotLambda(scope, 1, 1, lambda_0))") !=
+          std::string::npos);
+}
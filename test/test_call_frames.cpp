@@ -0,0 +1,145 @@
+#include "lisp_test.h"
+
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <new>
+#include <pthread.h>
+
+// operator new is replaced for the whole test binary, so it only counts
+// the allocations of the thread inside a CountingScope and otherwise
+// behaves like the default one
+namespace {
+thread_local bool counting = false;
+thread_local size_t allocations = 0;
+
+class CountingScope{
+public:
+    CountingScope() : previous_(counting) {
+        counting = true;
+    }
+    ~CountingScope() {
+        counting = previous_;
+    }
+
+private:
+    bool previous_;
+};
+}
+
+void* operator new(size_t size) {
+    if (counting) {
+        ++allocations;
+    }
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+struct CallFrameTest : LispTest {
+    size_t CountAllocations(const std::string& expression, const std::string& expected) {
+        CountingScope scope;
+        size_t before = allocations;
+        ExpectEq(expression, expected);
+        return allocations - before;
+    }
+
+    // allocations per frame of (depth n) for n between from and to
+    double AllocationsPerFrame(int from, int to) {
+        auto to_string = std::to_string(to);
+        auto from_string = std::to_string(from);
+        auto count = CountAllocations("(depth " + to_string + ")", to_string) -
+                     CountAllocations("(depth " + from_string + ")", from_string);
+        return static_cast<double>(count) / (to - from);
+    }
+};
+
+const int kMaxDepth = 10000;
+
+// the tree walker and the closure code recurse on the native stack, where a
+// call of an unoptimized or sanitized build takes kilobytes, so deep calls
+// run on a thread with a large stack; the calling thread waits for it
+void RunOnLargeStack(const std::function<void()>& body) {
+    struct Task {
+        const std::function<void()>* body;
+        std::exception_ptr error;
+    } task{&body, nullptr};
+    auto run = [](void* arg) -> void* {
+        auto task = static_cast<Task*>(arg);
+        try {
+            (*task->body)();
+        } catch (...) {
+            task->error = std::current_exception();
+        }
+        return nullptr;
+    };
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 512 << 20);
+    pthread_t thread;
+    REQUIRE(pthread_create(&thread, &attr, run, &task) == 0);
+    pthread_attr_destroy(&attr);
+    pthread_join(thread, nullptr);
+    if (task.error) {
+        std::rethrow_exception(task.error);
+    }
+}
+
+TEST_CASE_METHOD(CallFrameTest, "CallAllocationIsConstantPerFrame") {
+    ExpectNoError("(define (depth n) (if (= n 0) 0 (+ 1 (depth (- n 1)))))");
+    double shallow = 0;
+    double deep = 0;
+    RunOnLargeStack([&] {
+        auto max_depth = std::to_string(kMaxDepth);
+        ExpectEq("(depth " + max_depth + ")", max_depth);
+        shallow = AllocationsPerFrame(1000, 2000);
+        deep = AllocationsPerFrame(kMaxDepth - 4000, kMaxDepth);
+    });
+    CHECK(shallow == deep);
+    // frames come from the pool of the heap, and the machine code of a
+    // promoted lambda keeps its temps on the native stack
+    CHECK(shallow == 0);
+#ifdef __x86_64__
+    if (LISP_TEST_MODE == EvalMode::TREE_WALK){
+        ExpectEq("(car (tier-stats depth))", "(tier . compiled)");
+    }
+#endif
+}
+
+TEST_CASE_METHOD(CallFrameTest, "LoopIterationDoesNotAllocate") {
+    ExpectNoError("(define (count n acc) (if (= n 0) acc (count (- n 1) (+ acc 1))))");
+    ExpectEq("(count 2000 0)", "2000");
+    auto few = CountAllocations("(count 1000 0)", "1000");
+    auto many = CountAllocations("(count 11000 0)", "11000");
+    CHECK(many == few);
+}
+
+TEST_CASE("BuiltinCallDoesNotAllocate") {
+    std::stringstream in("(+ 1 (* 2 3) (- 4))");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    auto node = Resolver().Resolve(parser.Parse());
+    auto scope = std::make_shared<Scope>();
+    scope->AddName("+", ValueType(NodePtr(new Plus())));
+    scope->AddName("*", ValueType(NodePtr(new Mult())));
+    scope->AddName("-", ValueType(NodePtr(new Minus())));
+
+    CountingScope counting_scope;
+    size_t before = allocations;
+    auto value = node->ComputeValue(scope);
+    CHECK(allocations == before);
+    CHECK(value.AsInt() == 11);
+
+    before = allocations;
+    value = node->ComputeValue(scope);
+    CHECK(allocations == before);
+    CHECK(value.AsInt() == 11);
+}
@@ -0,0 +1,40 @@
+#include "heap_test.h"
+
+namespace {
+struct CekTest : HeapTest {
+    CekMachine machine;
+
+    std::string Run(const std::string& expression) {
+        std::stringstream in(expression);
+        Parser parser(std::make_shared<Tokenizer>(&in));
+        return machine.Run(Resolver().Resolve(parser.Parse()), scope).ToString();
+    }
+};
+}
+
+TEST_CASE_METHOD(CekTest, "CekRecursesOverMillionElementList") {
+    Run("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    Run("(define (size list) (if (null? list) 0 (+ 1 (size (cdr list)))))");
+    Run("(define list (build 1000000 '()))");
+    CHECK(Run("(size list)") == "1000000");
+    CHECK(machine.MaxDepth() >= 1000000);
+    CHECK(machine.MaxValues() >= 2000000);
+    CHECK(machine.MaxStackBytes() >= machine.MaxDepth() * sizeof(void*));
+    Run("(set! list '())");
+}
+
+TEST_CASE_METHOD(CekTest, "CekTailCallsDoNotGrowStack") {
+    Run("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    CHECK(Run("(count 100000)") == "done");
+    CHECK(machine.MaxDepth() < 10);
+    Run("(define (loop n) (and #t (or #f (if (= n 0) 'done (loop (- n 1))))))");
+    CHECK(Run("(loop 100000)") == "done");
+    CHECK(machine.MaxDepth() < 10);
+}
+
+TEST_CASE_METHOD(CekTest, "CekUnwindsOnError") {
+    Run("(define (fail n) (if (= n 0) (car 1) (+ 1 (fail (- n 1)))))");
+    CHECK_THROWS_AS(Run("(fail 100)"), const RuntimeError&);
+    CHECK(Run("(+ 1 2)") == "3");
+    CHECK(Run("(eval '(+ 1 (* 2 3)))") == "7");
+}
@@ -0,0 +1,52 @@
+#include "lisp_test.h"
+#include "heap_test.h"
+
+#include <lispp/closure_compiler.h>
+
+namespace {
+ValueType RunClosureCode(const std::string& expression, const std::shared_ptr<Scope>& scope) {
+    std::stringstream in(expression);
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    ClosureCompiler compiler(scope);
+    return compiler.Compile(Resolver().Resolve(parser.Parse()))(scope, nullptr);
+}
+}
+
+TEST_CASE_METHOD(HeapTest, "ClosureCompilerMakesCompiledClosures") {
+    auto lambda = RunClosureCode("(lambda (x y) (+ x y))", scope);
+    REQUIRE(lambda.GetType() == ValueType::ValueEnum::FUNC);
+    auto closure = dynamic_cast<CompiledClosure*>(lambda.AsNode());
+    REQUIRE(closure);
+    ValueType args[] = {ValueType(2), ValueType(3)};
+    CHECK(closure->Apply(ArgSpan(args, 2)).AsInt() == 5);
+    CHECK_THROWS_AS(closure->Apply(ArgSpan(args, 1)), const RuntimeError&);
+}
+
+TEST_CASE_METHOD(HeapTest, "ClosureTailCallsRunInConstantStack") {
+    RunClosureCode("(define (even n) (if (= n 0) #t (odd (- n 1))))", scope);
+    RunClosureCode("(define (odd n) (if (= n 0) #f (even (- n 1))))", scope);
+    CHECK(RunClosureCode("(even 1000000)", scope).AsBool());
+    RunClosureCode("(define (count n acc) (if (= n 0) acc (count (- n 1) (+ acc 1))))", scope);
+    CHECK(RunClosureCode("(count 1000000 0)", scope).AsInt() == 1000000);
+}
+
+TEST_CASE_METHOD(LispTest, "ClosureCodeObservesRedefinition") {
+    ExpectNoError("(define (f x) (+ x 1))");
+    ExpectNoError("(define (g x) (f x))");
+    ExpectEq("(g 1)", "2");
+    ExpectNoError("(define (f x) (* x 10))");
+    ExpectEq("(g 1)", "10");
+    ExpectNoError("(set! f 5)");
+    ExpectRuntimeError("(g 1)");
+}
+
+TEST_CASE_METHOD(LispTest, "CalleeOutlivesRebindingInArguments") {
+    ExpectNoError("(define (mk) (define n 0) "
+                  "(lambda () (if (= n 1) (set! f 0) (set! n 1)) 1))");
+    ExpectNoError("(define g (mk))");
+    ExpectNoError("(define (f x) (+ x 100))");
+    ExpectNoError("(define (h) (f (g)))");
+    ExpectEq("(h)", "101");
+    ExpectEq("(h)", "101");
+    ExpectRuntimeError("(h)");
+}
@@ -21,3 +21,10 @@ TEST_CASE_METHOD(LispTest, "IfSyntax") {
     ExpectSyntaxError("(if)");
     ExpectSyntaxError("(if 1 2 3 4)");
 }
+
+TEST_CASE_METHOD(LispTest, "SpecialFormsAreNotValues") {
+    ExpectNameError("if");
+    ExpectNameError("(define x and)");
+    ExpectSyntaxError("(define if 1)");
+    ExpectSyntaxError("(if #t 1 (if))");
+}
@@ -1,5 +1,7 @@
 #include "lisp_test.h"
 
+#include <thread>
+
 TEST_CASE_METHOD(LispTest, "Quote") {
     ExpectEq("(quote (1 2))", "(1 2)");
 }
@@ -8,3 +10,31 @@ TEST_CASE_METHOD(LispTest, "Eval") {
     ExpectEq("(eval '(max 1 2 3 4 5))", "5");
 
 }
+
+TEST_CASE("InterpretersRunOnSeparateThreads") {
+    std::string results[2];
+    auto run = [](int id, std::string* result) {
+        std::stringstream in;
+        std::stringstream out;
+        Lispp lisp(&in, &out, LISP_TEST_MODE);
+        auto name = "thread-global-" + std::to_string(id);
+        in.str("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n)))) "
+               "(define " + name + " 0) "
+               "(define (step n) (set! " + name + " n) (sum n 0)) "
+               "(define (loop n acc) (if (= n 0) acc (loop (- n 1) (step 100)))) "
+               "(loop 300 0)");
+        while (in.peek() != EOF){
+            lisp.Run();
+        }
+        std::string line;
+        while (getline(out, line)){
+            *result = line;
+        }
+    };
+    std::thread first(run, 0, &results[0]);
+    std::thread second(run, 1, &results[1]);
+    first.join();
+    second.join();
+    CHECK(results[0] == "     >> 5050");
+    CHECK(results[1] == "     >> 5050");
+}
@@ -0,0 +1,303 @@
+#include "lisp_test.h"
+
+#include <thread>
+
+TEST_CASE_METHOD(LispTest, "CollectorFreesClosureCycles") {
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(define (loop n) (make-counter) (if (= n 0) 0 (loop (- n 1))))");
+    ExpectEq("(loop 10)", "0");
+    auto heap = lisp.GetHeap();
+    heap->Collect();
+    size_t live = heap->ObjectCount();
+    // every frame of make-counter and the closure defined in it refer to
+    // each other
+    ExpectEq("(loop 1000)", "0");
+    CHECK(heap->ObjectCount() >= live + 2000);
+    CHECK(heap->Collect() >= 2000);
+    CHECK(heap->ObjectCount() <= live);
+}
+
+TEST_CASE_METHOD(LispTest, "CollectorFreesCircularLists") {
+    ExpectNoError("(define x (list 1 2 3))");
+    ExpectNoError("(set-cdr! (cdr (cdr x)) x)");
+    auto heap = lisp.GetHeap();
+    CHECK(heap->Collect() == 0);
+    ExpectEq("(car (cdr (cdr (cdr x))))", "1");
+    ExpectNoError("(set! x 0)");
+    CHECK(heap->Collect() >= 3);
+}
+
+TEST_CASE_METHOD(LispTest, "CollectorFreesCyclesThroughQuotedLists") {
+    ExpectNoError("(define k (lambda () '(1 2)))");
+    ExpectNoError("(set-cdr! (k) (list k))");
+    auto heap = lisp.GetHeap();
+    heap->Collect();
+    size_t before = heap->ObjectCount();
+    ExpectEq("(car (k))", "1");
+    // the closure is referenced from the list it returns
+    ExpectNoError("(set! k 0)");
+    heap->Collect();
+    CHECK(heap->ObjectCount() < before);
+
+    // the list is a constant of a lambda nested in the referenced one
+    ExpectNoError("(define (make) (lambda () '(3 4)))");
+    ExpectNoError("(set-cdr! ((make)) (list make))");
+    heap->Collect();
+    before = heap->ObjectCount();
+    ExpectNoError("(set! make 0)");
+    heap->Collect();
+    CHECK(heap->ObjectCount() < before);
+}
+
+TEST_CASE_METHOD(LispTest, "CollectorRunsDuringEvaluation") {
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(define (loop n) (make-counter) (if (= n 0) 0 (loop (- n 1))))");
+    auto heap = lisp.GetHeap();
+    auto collections = heap->MinorCollections();
+    ExpectEq("(loop 100000)", "0");
+    CHECK(heap->MinorCollections() > collections);
+    CHECK(heap->ObjectCount() < 200000);
+}
+
+TEST_CASE_METHOD(LispTest, "MinorCollectionsPromoteSurvivors") {
+    auto heap = lisp.GetHeap();
+    heap->CollectMinor();
+    CHECK(heap->YoungCount() == 0);
+    ExpectNoError("(define x (list 1 2 3))");
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(make-counter)");
+    CHECK(heap->YoungCount() > 0);
+    // the frame of make-counter and next are young garbage
+    CHECK(heap->CollectMinor() >= 2);
+    CHECK(heap->YoungCount() == 0);
+    ExpectEq("x", "(1 2 3)");
+}
+
+TEST_CASE_METHOD(LispTest, "HandlesAreRoots") {
+    auto heap = lisp.GetHeap();
+    HeapScope heap_scope(heap);
+    auto pair = NodePtr(new Pair(NodeFromValue(ValueType(1)), nullptr));
+    static_cast<Pair*>(pair.get())->SetCdr(ValueType(pair));
+    {
+        Handle handle(heap, ValueType(pair));
+        pair = nullptr;
+        CHECK(heap->Collect() == 0);
+        auto car = static_cast<Pair*>(handle.Get().AsNode())->Car();
+        CHECK(car->ToString() == "1");
+    }
+    // the car is stored in the pair itself
+    CHECK(heap->Collect() == 1);
+}
+
+struct IncrementalGcTest : LispTest {
+    IncrementalGcTest() : LispTest(GcConfig{std::chrono::microseconds(100)}) {}
+};
+
+TEST_CASE_METHOD(IncrementalGcTest, "IncrementalMarkingKeepsMutatedData") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectNoError("(define big (build 100000 '()))");
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    // moves the elements of big one pair to the left while collecting
+    ExpectNoError("(define (shift lst) (make-counter) (if (null? (cdr lst)) 0 "
+                  "(begin-shift lst)))");
+    ExpectNoError("(define (begin-shift lst) (set-car! lst (car (cdr lst))) (shift (cdr lst)))");
+    ExpectNoError("(define (nth lst n) (if (= n 0) (car lst) (nth (cdr lst) (- n 1))))");
+    auto heap = lisp.GetHeap();
+    auto collections = heap->Collections();
+    heap->StartCollection();
+    CHECK(heap->IsMarking());
+    ExpectEq("(shift big)", "0");
+    for (int i = 0; i < 1000 && heap->IsMarking(); ++i){
+        ExpectNoError("(build 2000 '())");
+    }
+    CHECK(heap->Collections() > collections);
+    ExpectEq("(nth big 0)", "2");
+    ExpectEq("(nth big 99998)", "100000");
+    // steps of incremental marking are pauses of their own
+    CHECK(heap->Pauses().pauses > heap->Collections() + heap->MinorCollections());
+}
+
+struct ConcurrentGcTest : LispTest {
+    ConcurrentGcTest() : LispTest(GcConfig{std::chrono::microseconds(0), true}) {}
+};
+
+TEST_CASE_METHOD(ConcurrentGcTest, "ConcurrentMarkingKeepsMutatedData") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectNoError("(define big (build 100000 '()))");
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(define (shift lst) (make-counter) (if (null? (cdr lst)) 0 "
+                  "(begin-shift lst)))");
+    ExpectNoError("(define (begin-shift lst) (set-car! lst (car (cdr lst))) (shift (cdr lst)))");
+    ExpectNoError("(define (nth lst n) (if (= n 0) (car lst) (nth (cdr lst) (- n 1))))");
+    auto heap = lisp.GetHeap();
+    auto collections = heap->Collections();
+    heap->StartCollection();
+    CHECK(heap->IsMarking());
+    ExpectEq("(shift big)", "0");
+    // the collection ends at a safepoint after the marker is done
+    for (int i = 0; i < 1000 && heap->IsMarking(); ++i){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ExpectNoError("(build 2000 '())");
+    }
+    CHECK(!heap->IsMarking());
+    CHECK(heap->Collections() > collections);
+    ExpectEq("(nth big 0)", "2");
+    ExpectEq("(nth big 99998)", "100000");
+}
+
+TEST_CASE_METHOD(ConcurrentGcTest, "ConcurrentMarkingKeepsLocalsSetWhileMarking") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectNoError("(define (nth lst n) (if (= n 0) (car lst) (nth (cdr lst) (- n 1))))");
+    ExpectNoError("(define (make-box v) (define (swap new) (define old v) (set! v new) old) swap)");
+    ExpectNoError("(define box (make-box (build 1000 '())))");
+    auto heap = lisp.GetHeap();
+    heap->StartCollection();
+    CHECK(heap->IsMarking());
+    ExpectEq("(nth (box (build 500 '())) 999)", "1000");
+    for (int i = 0; i < 1000 && heap->IsMarking(); ++i){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ExpectNoError("(build 2000 '())");
+    }
+    CHECK(!heap->IsMarking());
+    ExpectEq("(nth (box '()) 499)", "500");
+}
+
+TEST_CASE_METHOD(ConcurrentGcTest, "ConcurrentMarkingKeepsNewObjectsUntilNextCollection") {
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(define x (list 1 2 3))");
+    auto heap = lisp.GetHeap();
+    heap->StartCollection();
+    ExpectNoError("(make-counter)");
+    ExpectNoError("(set-cdr! x '())");
+    // the frame of make-counter and next were allocated while marking
+    heap->Collect();
+    CHECK(heap->Collect() >= 2);
+    ExpectEq("x", "(1)");
+}
+
+TEST_CASE_METHOD(LispTest, "GcConfigSetsMaxPause") {
+    ExpectEq("(gc-config)", "((max-pause-us . 0) (concurrent . #f))");
+    ExpectEq("(gc-config 500)", "((max-pause-us . 500) (concurrent . #f))");
+    CHECK(lisp.GetHeap()->Config().max_pause == std::chrono::microseconds(500));
+    ExpectEq("(gc-config 0 #t)", "((max-pause-us . 0) (concurrent . #t))");
+    CHECK(lisp.GetHeap()->Config().concurrent);
+    ExpectRuntimeError("(gc-config -1)");
+    ExpectRuntimeError("(gc-config 1 2)");
+    ExpectRuntimeError("(gc-config 1 #t 2)");
+}
+
+TEST_CASE_METHOD(LispTest, "GcPausesReportsHistogram") {
+    lisp.GetHeap()->Collect();
+    ExpectEq("(> (cdr (car (gc-pauses))) 0)", "#t");
+    ExpectEq("(car (car (cdr (cdr (cdr (gc-pauses))))))", "histogram");
+    ExpectEq("(pair? (car (cdr (car (cdr (cdr (cdr (gc-pauses))))))))", "#t");
+}
+
+TEST_CASE_METHOD(LispTest, "HeapStatsCountsObjectsByKind") {
+    auto before = lisp.HeapStats();
+    ExpectNoError("(define x (list 1 2 3))");
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(define counter (make-counter))");
+    auto stats = lisp.HeapStats();
+    CHECK(stats.pairs >= before.pairs + 3);
+    CHECK(stats.closures >= before.closures + 2);
+    CHECK(stats.scopes >= before.scopes + 1);
+    CHECK(stats.bytes_allocated > before.bytes_allocated);
+    CHECK(stats.objects_allocated > before.objects_allocated);
+    CHECK(stats.live_bytes > 0);
+    CHECK(stats.reserved_bytes >= stats.live_bytes);
+    CHECK(stats.pairs + stats.consts + stats.closures + stats.scopes + stats.other ==
+          lisp.GetHeap()->ObjectCount());
+    lisp.GetHeap()->Collect();
+    CHECK(lisp.HeapStats().collections == before.collections + 1);
+    CHECK(lisp.HeapStats().pauses.pauses > before.pauses.pauses);
+}
+
+TEST_CASE_METHOD(LispTest, "HeapStatsBuiltin") {
+    ExpectEq("(car (car (heap-stats)))", "pairs");
+    ExpectNoError("(define stats (heap-stats))");
+    ExpectEq("(car (list-ref stats 7))", "bytes-allocated");
+    ExpectEq("(> (cdr (list-ref stats 7)) 0)", "#t");
+    ExpectEq("(car (list-ref stats 14))", "pause-max-us");
+    ExpectRuntimeError("(heap-stats 1)");
+}
+
+struct MemoryLimitTest : LispTest {
+    MemoryLimitTest() : LispTest(LimitedConfig()) {}
+
+    static GcConfig LimitedConfig() {
+        GcConfig config;
+        config.memory_limit = 2 << 20;
+        return config;
+    }
+};
+
+TEST_CASE_METHOD(MemoryLimitTest, "MemoryLimitRaisesRuntimeError") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectRuntimeError("(define big (build 1000000 '()))");
+    // the list is freed while the error unwinds
+    ExpectNoError("(define small (build 1000 '()))");
+    ExpectEq("(car small)", "1");
+    CHECK(lisp.GetHeap()->Pool()->LiveBytes() <= lisp.GetHeap()->Config().memory_limit);
+}
+
+TEST_CASE_METHOD(MemoryLimitTest, "MemoryLimitCollectsCyclesFirst") {
+    ExpectNoError("(define (make-counter) (define (next) 1) next)");
+    ExpectNoError("(define (loop n) (make-counter) (if (= n 0) 0 (loop (- n 1))))");
+    // far more cycles than fit under the limit, freed by a minor or a full
+    // collection depending on whether the nursery or the limit is reached
+    // first
+    ExpectEq("(loop 100000)", "0");
+    CHECK(lisp.GetHeap()->Collections() + lisp.GetHeap()->MinorCollections() > 0);
+}
+
+TEST_CASE_METHOD(MemoryLimitTest, "MemoryLimitBoundsDeepRecursion") {
+    // the tree walker and closure code recurse on the native stack, which
+    // would overflow first
+    if (LISP_TEST_MODE != EvalMode::BYTECODE && LISP_TEST_MODE != EvalMode::CEK){
+        return;
+    }
+    ExpectNoError("(define (depth n) (if (= n 0) 0 (+ 1 (depth (- n 1)))))");
+    // the stacks are kept at their largest size and counted as live
+    ExpectEq("(depth 5000)", "5000");
+    CHECK(lisp.GetHeap()->Pool()->LiveBytes() > 5000 * sizeof(ValueType));
+    ExpectRuntimeError("(depth 10000000)");
+    // the stacks are freed while the error unwinds
+    CHECK(lisp.GetHeap()->Pool()->LiveBytes() < lisp.GetHeap()->Config().memory_limit / 2);
+    ExpectEq("(depth 1000)", "1000");
+}
+
+TEST_CASE("PoolArenaBumpAllocates") {
+    ObjectPool pool;
+    auto first = pool.Allocate(32);
+    pool.Free(first, 32);
+    CHECK(pool.Allocate(32) == first);
+    pool.Free(first, 32);
+    {
+        PoolArena arena(&pool);
+        auto second = static_cast<char*>(pool.Allocate(32));
+        auto third = static_cast<char*>(pool.Allocate(48));
+        CHECK(second != first);
+        CHECK(third == second + 32);
+    }
+    CHECK(pool.Allocate(32) == first);
+}
+
+TEST_CASE_METHOD(LispTest, "PairsStoreIntegersInline") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    auto heap = lisp.GetHeap();
+    heap->Collect();
+    auto before = lisp.HeapStats();
+    ExpectNoError("(define numbers (build 1000 '()))");
+    ExpectNoError("(define flags (list #t #f #t))");
+    heap->Collect();
+    auto stats = lisp.HeapStats();
+    CHECK(stats.pairs - before.pairs == 1003);
+    CHECK(stats.consts == before.consts);
+    ExpectEq("(car numbers)", "1");
+    ExpectEq("(car (cdr flags))", "#f");
+    ExpectNoError("(set-car! numbers 7)");
+    ExpectEq("(list-ref numbers 0)", "7");
+    ExpectEq("(list-tail flags 1)", "(#f #t)");
+    ExpectEq("(equal? flags '(#t #f #t))", "#t");
+}
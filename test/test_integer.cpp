@@ -110,3 +110,50 @@ TEST_CASE_METHOD(LispTest, "IntegerAbsEdgeCases") {
     ExpectRuntimeError("(abs #t)");
     ExpectRuntimeError("(abs 1 2)");
 }
+
+TEST_CASE_METHOD(LispTest, "IntegerFullRange") {
+    ExpectEq("(+ 4611686018427387903 1)", "4611686018427387904");
+    ExpectEq("(- -4611686018427387904 1)", "-4611686018427387905");
+    ExpectEq("9223372036854775807", "9223372036854775807");
+    ExpectEq("(- 9223372036854775807 9223372036854775806)", "1");
+    ExpectEq("(number? 9223372036854775807)", "#t");
+    ExpectEq("(= 9223372036854775807 9223372036854775807)", "#t");
+}
+
+TEST_CASE_METHOD(LispTest, "ArithmeticSitesLeaveFixnumPath") {
+    ExpectNoError("(define (add a b) (+ a b))");
+    ExpectNoError("(define (mul a b) (* a b))");
+    ExpectNoError("(define (less a b) (< a b))");
+    ExpectEq("(add 1 2)", "3");
+    ExpectEq("(add 2305843009213693951 2305843009213693951)", "4611686018427387902");
+    ExpectEq("(add 4611686018427387903 1)", "4611686018427387904");
+    ExpectEq("(mul 3 4)", "12");
+    ExpectEq("(mul 2305843009213693951 2)", "4611686018427387902");
+    ExpectEq("(mul 4611686018427387904 1)", "4611686018427387904");
+    ExpectEq("(less 1 2)", "#t");
+    ExpectRuntimeError("(less 1 #t)");
+    ExpectEq("(less 2 1)", "#f");
+    ExpectRuntimeError("(add 1 '())");
+    ExpectEq("(add 5 6)", "11");
+}
+
+TEST_CASE("CallSitesRecordTypeFeedback") {
+    std::stringstream in("(+ x 1)");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    auto node = Resolver().Resolve(parser.Parse());
+    auto call = dynamic_cast<CallExpr*>(node.get());
+    REQUIRE(call);
+    auto scope = std::make_shared<Scope>();
+    AddBuiltins(scope.get());
+    CHECK(call->Feedback() == TypeFeedback::UNSEEN);
+
+    scope->AddName("x", ValueType(1));
+    CHECK(node->ComputeValue(scope).AsInt() == 2);
+    CHECK(node->ComputeValue(scope).AsInt() == 2);
+    CHECK(call->Feedback() == TypeFeedback::FIXNUM);
+
+    scope->SetValue(Symbol::Intern("x"), ValueType(INT64_MAX - 1));
+    CHECK(node->ComputeValue(scope).AsInt() == INT64_MAX);
+    CHECK(node->ComputeValue(scope).AsInt() == INT64_MAX);
+    CHECK(call->Feedback() == TypeFeedback::GENERIC);
+}
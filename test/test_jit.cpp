@@ -0,0 +1,157 @@
+#include "lisp_test.h"
+
+#include <thread>
+
+// in the tree walking mode these run long enough for the lambdas to be
+// compiled, see jit.h
+
+TEST_CASE_METHOD(LispTest, "JitArithmetic") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    ExpectEq("(sum 5000 0)", "12502500");
+    ExpectEq("(sum 10 0)", "55");
+
+    ExpectNoError("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    ExpectEq("(fib 20)", "6765");
+
+    ExpectNoError("(define (grow n acc) (if (= n 0) acc (grow (- n 1) (+ acc 4611686018427387))))");
+    ExpectEq("(grow 1500 0)", "6917529027641080500");
+    ExpectEq("(grow 1500 (- 0 6917529027641080500))", "0");
+}
+
+TEST_CASE_METHOD(LispTest, "JitObservesRedefinition") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    ExpectEq("(sum 2000 0)", "2001000");
+
+    ExpectNoError("(define plus +)");
+    ExpectNoError("(define + -)");
+    ExpectEq("(sum 3 0)", "-6");
+    ExpectNoError("(define + plus)");
+    ExpectEq("(sum 3 0)", "6");
+
+    ExpectNoError("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    ExpectEq("(count 2000)", "done");
+    ExpectNoError("(define old-count count)");
+    ExpectNoError("(define (count n) 'redefined)");
+    ExpectEq("(old-count 5)", "redefined");
+}
+
+TEST_CASE_METHOD(LispTest, "JitSelfTailWhoseArgumentsRebind") {
+    // every argument bumps the binding version, the loop must not nest
+    ExpectNoError("(define c 0)");
+    ExpectNoError("(define (step n) (set! c n) (- n 1))");
+    ExpectNoError("(define (loop n) (if (= n 0) 'done (loop (step n))))");
+    ExpectEq("(loop 1000000)", "done");
+    ExpectEq("c", "1");
+
+    // the head is looked up before the arguments rebind it
+    ExpectNoError("(define (other n) 'other)");
+    ExpectNoError("(define (count n) (if (= n 0) 'done (count (swap n))))");
+    ExpectNoError("(define (swap n) (if (= n 1) (set! count other) #f) (- n 1))");
+    ExpectEq("(count 2000)", "done");
+    ExpectEq("(count 5)", "other");
+}
+
+TEST_CASE_METHOD(LispTest, "JitLooksUpOperatorBeforeOperands") {
+    ExpectNoError("(define plus +)");
+    ExpectNoError("(define times *)");
+    ExpectNoError("(define (rebind) (set! + times) 5)");
+    ExpectNoError("(define (f n) (set! + plus) (if (= n 0) (+ (rebind) 2) (f (- n 1))))");
+    ExpectEq("(f 0)", "7");
+    ExpectEq("(f 3000)", "7");
+    ExpectEq("(f 0)", "7");
+    ExpectNoError("(set! + plus)");
+}
+
+struct JitMemoryLimitTest : LispTest {
+    JitMemoryLimitTest() : LispTest(LimitedConfig()) {}
+
+    static GcConfig LimitedConfig() {
+        GcConfig config;
+        config.memory_limit = 50000000;
+        return config;
+    }
+};
+
+TEST_CASE_METHOD(JitMemoryLimitTest, "JitLoopReachesSafepoints") {
+    // every iteration leaves a cycle only a collection frees
+    ExpectNoError("(define (loop n p) (set-cdr! p p) (if (= n 0) 'done (loop (- n 1) (list n))))");
+    ExpectEq("(loop 2000000 (list 0))", "done");
+    CHECK(lisp.GetHeap()->Pool()->LiveBytes() < lisp.GetHeap()->Config().memory_limit / 2);
+}
+
+struct JitConcurrentGcTest : LispTest {
+    JitConcurrentGcTest() : LispTest(GcConfig{std::chrono::microseconds(0), true}) {}
+};
+
+TEST_CASE_METHOD(JitConcurrentGcTest, "JitPromotesWhileMarking") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectNoError("(define big (build 100000 '()))");
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    auto heap = lisp.GetHeap();
+    heap->StartCollection();
+    CHECK(heap->IsMarking());
+    // the marker traces sum while its code is published
+    ExpectEq("(sum 2000 0)", "2001000");
+    for (int i = 0; i < 1000 && heap->IsMarking(); ++i){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ExpectNoError("(build 2000 '())");
+    }
+    CHECK(!heap->IsMarking());
+    heap->Collect();
+    ExpectEq("(sum 10 0)", "55");
+    ExpectEq("(car big)", "1");
+}
+
+TEST_CASE_METHOD(LispTest, "JitGuardsOutliveRebinding") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    ExpectEq("(sum 2000 0)", "2001000");
+
+    // the freed builtin's memory must not pass for it in the guards
+    ExpectNoError("(define + car)");
+    ExpectNoError("(define + (if #f #f))");
+    ExpectRuntimeError("(sum 3 0)");
+    ExpectNoError("(define (fresh n acc) (if (= n 0) acc (fresh (- n 1) (+ acc n))))");
+    ExpectRuntimeError("(fresh 3 0)");
+}
+
+TEST_CASE_METHOD(LispTest, "JitErrors") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    ExpectEq("(sum 2000 0)", "2001000");
+    ExpectRuntimeError("(sum 10 #t)");
+    ExpectRuntimeError("(sum 10)");
+
+    ExpectNoError("(define (early n) (if (= n 0) (begin-with x) (early (- n 1))) (define x 1))");
+    ExpectNameError("(early 2000)");
+}
+
+TEST_CASE_METHOD(LispTest, "JitKeepsSpilledLocalsAlive") {
+    ExpectNoError("(define big 4611686018427387903)");
+    ExpectNoError("(define (L x) (define (h) (set! x 0) 1) (+ x (h)))");
+    ExpectNoError("(define (run n r) (if (= n 0) r (run (- n 1) (L (+ big 1)))))");
+    ExpectEq("(run 1500 0)", "4611686018427387905");
+    ExpectEq("(L (+ big 1))", "4611686018427387905");
+}
+
+TEST_CASE_METHOD(LispTest, "JitKeepsCapturedFrames") {
+    ExpectNoError("(define (make n acc) (if (= n 0) acc (make (- n 1) (cons (lambda () n) acc))))");
+    ExpectNoError("(define closures (make 2000 '()))");
+    ExpectEq("((car closures))", "1");
+    ExpectEq("((car (cdr closures)))", "2");
+}
+
+TEST_CASE_METHOD(LispTest, "TierStatsReportsThresholds") {
+    ExpectEq("(car (car (tier-stats)))", "call-threshold");
+    ExpectEq("(cdr (car (tier-stats)))", "1000");
+    ExpectEq("(car (list-ref (tier-stats) 5))", "promotions");
+    ExpectRuntimeError("(tier-stats 1)");
+}
+
+TEST_CASE_METHOD(LispTest, "TierStatsCountsCallsAndBackEdges") {
+    ExpectNoError("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    ExpectEq("(count 10)", "done");
+    ExpectEq("(tier-stats count)", "((tier . interpreted) (calls . 11) (back-edges . 10))");
+    ExpectNoError("(define (f x) x)");
+    ExpectEq("(f 1)", "1");
+    ExpectEq("(tier-stats f)", "((tier . interpreted) (calls . 1) (back-edges . 0))");
+    ExpectRuntimeError("(tier-stats car)");
+}
@@ -44,3 +44,61 @@ TEST_CASE_METHOD(LispTest, "DefineLambdaSugar") {
     ExpectNoError("(define (zero) 0)");
     ExpectEq("(zero)", "0");
 }
+
+TEST_CASE_METHOD(LispTest, "LexicalScope") {
+    ExpectNoError("(define (get-y) y)");
+    ExpectNoError("(define (call-with-y y) (get-y))");
+    ExpectNameError("(call-with-y 1)");
+
+    ExpectNoError("(define y 2)");
+    ExpectEq("(call-with-y 1)", "2");
+}
+
+TEST_CASE_METHOD(LispTest, "InternalDefine") {
+    ExpectNoError("(define (f x) (define y (* x 2)) (define (g) (+ x y)) (g))");
+    ExpectEq("(f 5)", "15");
+    ExpectNameError("y");
+    ExpectNameError("g");
+
+    ExpectNoError("(define (h) (set! z 1) (define z 2) z)");
+    ExpectNameError("(h)");
+}
+
+TEST_CASE_METHOD(LispTest, "ClosuresShareFrame") {
+    ExpectNoError("(define (counter) (define n 0) (cons (lambda () (set! n (+ n 1)) n) (lambda () n)))");
+    ExpectNoError("(define c (counter))");
+    ExpectNoError("((car c))");
+    ExpectNoError("((car c))");
+    ExpectEq("((cdr c))", "2");
+}
+
+TEST_CASE_METHOD(LispTest, "TailCallsRunInConstantStack") {
+    ExpectNoError("(define (count-down n) (if (= n 0) 'done (count-down (- n 1))))");
+    ExpectEq("(count-down 100000)", "done");
+
+    ExpectNoError("(define (even-and n) (and #t (or (= n 0) (odd-and (- n 1)))))");
+    ExpectNoError("(define (odd-and n) (and (not (= n 0)) (even-and (- n 1))))");
+    ExpectEq("(even-and 100000)", "#t");
+    ExpectEq("(odd-and 100000)", "#f");
+
+    ExpectNoError("(define (loop n acc) (define next (+ acc 1)) (if (= n 0) acc (loop (- n 1) next)))");
+    ExpectEq("(loop 100000 0)", "100000");
+}
+
+TEST_CASE_METHOD(LispTest, "RedefinedCalleeIsCalled") {
+    ExpectNoError("(define op +)");
+    ExpectNoError("(define (apply-op a b) (op a b))");
+    ExpectEq("(apply-op 5 3)", "8");
+    ExpectEq("(apply-op 5 3)", "8");
+
+    ExpectNoError("(define op -)");
+    ExpectEq("(apply-op 5 3)", "2");
+
+    ExpectNoError("(define (swap-op a b) (set! op *) (op a b))");
+    ExpectEq("(swap-op 5 3)", "15");
+    ExpectEq("(apply-op 5 3)", "15");
+
+    ExpectNoError("(define (self-replace) (set! self-replace (lambda () 'new)) 'old)");
+    ExpectEq("(self-replace)", "old");
+    ExpectEq("(self-replace)", "new");
+}
@@ -4,6 +4,8 @@ TEST_CASE_METHOD(LispTest, "ListsAreNotSelfEvaliating") {
     ExpectRuntimeError("()");
     ExpectRuntimeError("(1)");
     ExpectRuntimeError("(1 2 3)");
+    ExpectRuntimeError("((list 1 2) 3)");
+    ExpectRuntimeError("('() 1)");
 
     ExpectEq("'()", "()");
     ExpectEq("'(1)", "(1)");
@@ -76,3 +78,25 @@ TEST_CASE_METHOD(LispTest, "ListOperations") {
     ExpectRuntimeError("(list-ref '(1 2 3) 10)");
     ExpectRuntimeError("(list-tail '(1 2 3) 10)");
 }
+
+TEST_CASE_METHOD(LispTest, "SetCdrSplitsListRuns") {
+    ExpectNoError("(define x (list 1 2 3 4 5))");
+    ExpectNoError("(define tail (list-tail x 0))");
+    ExpectNoError("(define y (cdr (cdr x)))");
+    ExpectNoError("(set-cdr! (cdr x) '(7 8))");
+    ExpectEq("x", "(1 2 7 8)");
+    ExpectEq("(list-ref x 3)", "8");
+    ExpectRuntimeError("(list-ref x 4)");
+    ExpectEq("y", "(3 4 5)");
+    ExpectEq("(list-ref y 2)", "5");
+    ExpectEq("tail", "(1 2 3 4 5)");
+
+    ExpectNoError("(define z '(1 2 3 4))");
+    ExpectNoError("(set-cdr! (cdr (cdr z)) 9)");
+    ExpectEq("z", "(1 2 3 . 9)");
+    ExpectEq("(list? z)", "#f");
+    ExpectRuntimeError("(list-ref z 1)");
+    ExpectNoError("(set-cdr! (cdr (cdr z)) '())");
+    ExpectEq("(list-ref z 2)", "3");
+    ExpectEq("(list-tail z 3)", "()");
+}
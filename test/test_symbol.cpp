@@ -1,5 +1,7 @@
 #include "lisp_test.h"
 
+#include <thread>
+
 TEST_CASE_METHOD(LispTest, "SymbolsAreNotSelfEvaluating") {
     ExpectNameError("x");
 
@@ -42,3 +44,36 @@ TEST_CASE_METHOD(LispTest, "SetInvalidSyntax") {
     ExpectSyntaxError("(set! 1)");
     ExpectSyntaxError("(set! x 1 2)");
 }
+
+TEST_CASE("SymbolsAreInterned") {
+    auto first = Symbol::Intern("interned-symbol");
+    auto second = Symbol::Intern(std::string("interned-") + "symbol");
+    CHECK(first == second);
+    CHECK(first != Symbol::Intern("other-symbol"));
+    CHECK(first.Name() == "interned-symbol");
+}
+
+TEST_CASE("SymbolsAreInternedFromSeveralThreads") {
+    std::vector<Symbol> symbols[2];
+    auto intern = [](std::vector<Symbol>* out) {
+        for (int i = 0; i < 2000; ++i){
+            auto symbol = Symbol::Intern("threaded-symbol-" + std::to_string(i));
+            symbol.Name();
+            out->push_back(symbol);
+        }
+    };
+    std::thread first(intern, &symbols[0]);
+    std::thread second(intern, &symbols[1]);
+    first.join();
+    second.join();
+    CHECK(symbols[0] == symbols[1]);
+    CHECK(symbols[0][7].Name() == "threaded-symbol-7");
+}
+
+TEST_CASE_METHOD(LispTest, "SymbolsCompareByIdentity") {
+    ExpectNoError("(define x 'abc)");
+    ExpectEq("(eq? x 'abc)", "#t");
+    ExpectEq("(eq? x 'abd)", "#f");
+    ExpectEq("(equal? (list 'a 'b) '(a b))", "#t");
+    ExpectEq("(eq? (car (list 'a)) (car '(a)))", "#t");
+}
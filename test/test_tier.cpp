@@ -0,0 +1,80 @@
+#include "lisp_test.h"
+#include <lispp/jit.h>
+
+// built into the tree walking tests only, the mode in which lambdas are
+// promoted to machine code, see jit.h
+
+TEST_CASE_METHOD(LispTest, "HotLambdaIsCompiled") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    ExpectEq("(car (tier-stats sum))", "(tier . interpreted)");
+    ExpectEq("(sum 2000 0)", "2001000");
+#ifdef __x86_64__
+    ExpectEq("(car (tier-stats sum))", "(tier . compiled)");
+#else
+    ExpectEq("(car (tier-stats sum))", "(tier . interpreted)");
+#endif
+}
+
+TEST_CASE_METHOD(LispTest, "TierStatsCountsPromotion") {
+    ExpectNoError("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    ExpectEq("(count 10)", "done");
+    ExpectEq("(tier-stats count)", "((tier . interpreted) (calls . 11) (back-edges . 10))");
+    ExpectEq("(count 2000)", "done");
+#ifdef __x86_64__
+    // promoted at the 1000th back edge, later iterations loop in machine code
+    ExpectEq("(tier-stats count)", "((tier . compiled) (calls . 1000) (back-edges . 2010))");
+    ExpectEq("(cdr (list-ref (tier-stats) 5))", "1");
+#else
+    ExpectEq("(tier-stats count)", "((tier . interpreted) (calls . 2012) (back-edges . 2010))");
+    ExpectEq("(cdr (list-ref (tier-stats) 5))", "0");
+#endif
+}
+
+TEST_CASE("TierStatsArePerInterpreter") {
+    auto promotions = JitTierStats().promotions;
+    LispTest first;
+    first.ExpectNoError("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    first.ExpectEq("(count 2000)", "done");
+    LispTest second;
+    second.ExpectEq("(cdr (list-ref (tier-stats) 5))", "0");
+#ifdef __x86_64__
+    first.ExpectEq("(cdr (list-ref (tier-stats) 5))", "1");
+#endif
+    // interpreters leave the state of the thread alone
+    CHECK(JitTierStats().promotions == promotions);
+}
+
+TEST_CASE("TierThresholdsArePassedToTheInterpreter") {
+    TierThresholds thresholds;
+    thresholds.calls = 5;
+    thresholds.back_edges = 3;
+    LispTest test(GcConfig(), thresholds);
+    test.ExpectEq("(tier-config)", "((call-threshold . 5) (back-edge-threshold . 3))");
+    test.ExpectNoError("(define (count n) (if (= n 0) 'done (count (- n 1))))");
+    test.ExpectEq("(count 2)", "done");
+    test.ExpectEq("(car (tier-stats count))", "(tier . interpreted)");
+    test.ExpectEq("(count 10)", "done");
+#ifdef __x86_64__
+    // promoted at the fifth call, the third back edge, instead of the 1000th
+    test.ExpectEq("(tier-stats count)", "((tier . compiled) (calls . 5) (back-edges . 12))");
+#else
+    test.ExpectEq("(car (tier-stats count))", "(tier . interpreted)");
+#endif
+}
+
+TEST_CASE_METHOD(LispTest, "TierConfigSetsThresholds") {
+    ExpectEq("(tier-config)", "((call-threshold . 1000) (back-edge-threshold . 1000))");
+    ExpectEq("(tier-config 2)", "((call-threshold . 2) (back-edge-threshold . 1000))");
+    ExpectEq("(tier-config 2 100000)", "((call-threshold . 2) (back-edge-threshold . 100000))");
+    ExpectEq("(cdr (car (tier-stats)))", "2");
+    ExpectNoError("(define (f x) (if (= x 0) 0 x))");
+    ExpectEq("(f 1)", "1");
+    ExpectEq("(car (tier-stats f))", "(tier . interpreted)");
+    ExpectEq("(f 2)", "2");
+#ifdef __x86_64__
+    ExpectEq("(car (tier-stats f))", "(tier . compiled)");
+#endif
+    ExpectRuntimeError("(tier-config -1)");
+    ExpectRuntimeError("(tier-config 1 #t)");
+    ExpectRuntimeError("(tier-config 1 2 3)");
+}
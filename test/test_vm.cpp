@@ -0,0 +1,199 @@
+#include "lisp_test.h"
+#include "heap_test.h"
+#include <lispp/compiler.h>
+#include <lispp/resolver.h>
+#include <lispp/folder.h>
+
+TEST_CASE("CompilerInlinesSpecialForms") {
+    std::stringstream in("(if (< x 1) (f x) 2)");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    auto code = Compiler().Compile(Resolver().Resolve(parser.Parse()));
+    CHECK(Disassemble(*code) ==
+          "0 LOAD_GLOBAL <\n"
+          "1 LOAD_GLOBAL x\n"
+          "2 CONST 1\n"
+          "3 CALL 2\n"
+          "4 JUMP_IF_FALSE 9\n"
+          "5 LOAD_GLOBAL f\n"
+          "6 LOAD_GLOBAL x\n"
+          "7 TAIL_CALL 1\n"
+          "8 JUMP 10\n"
+          "9 CONST 2\n"
+          "10 RETURN\n");
+}
+
+TEST_CASE("CompilerAddressesLocalSlots") {
+    std::stringstream in("(lambda (x) (define y x) (set! x y) (lambda () y))");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    auto code = Compiler().Compile(Resolver().Resolve(parser.Parse()));
+    REQUIRE(code->functions.size() == 1);
+    auto& function = *code->functions[0];
+    CHECK(function.arity == 1);
+    CHECK(function.frame_size == 2);
+    CHECK(Disassemble(function) ==
+          "0 LOAD_LOCAL 0 0 x\n"
+          "1 DEFINE_LOCAL 0 1 y\n"
+          "2 POP\n"
+          "3 LOAD_LOCAL 0 1 y\n"
+          "4 SET_LOCAL 0 0 x\n"
+          "5 POP\n"
+          "6 MAKE_CLOSURE 0\n"
+          "7 RETURN\n");
+    CHECK(Disassemble(*function.functions[0]) ==
+          "0 LOAD_LOCAL 1 1 y\n"
+          "1 RETURN\n");
+}
+
+TEST_CASE_METHOD(LispTest, "FunctionArity") {
+    ExpectNoError("(define (f x) x)");
+    ExpectRuntimeError("(f)");
+    ExpectRuntimeError("(f 1 2)");
+    ExpectEq("(f 1)", "1");
+}
+
+TEST_CASE_METHOD(LispTest, "EvalConstructedList") {
+    ExpectEq("(eval (list '+ 1 2))", "3");
+    ExpectEq("(eval (list 'if #f 1 2))", "2");
+}
+
+TEST_CASE_METHOD(LispTest, "QuotedNumbersAreNumbers") {
+    ExpectEq("(number? '5)", "#t");
+    ExpectEq("(+ (car '(1 2)) 1)", "2");
+    ExpectEq("(equal? '(a b) '(a b))", "#t");
+}
+
+TEST_CASE("ResolverBuildsSpecialFormNodes") {
+    std::stringstream in("(if x (and x (or)) (define y 'z)) (set! y (quote w)) (f x)");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    Resolver resolver;
+    auto if_node = resolver.Resolve(parser.Parse());
+    REQUIRE(if_node->Type() == NodeType::IF);
+    auto& if_expr = *static_cast<IfExpr*>(if_node.get());
+    CHECK(if_expr.Test()->Type() == NodeType::VAR);
+    REQUIRE(if_expr.Consequent()->Type() == NodeType::AND);
+    CHECK(static_cast<LogicExpr*>(if_expr.Consequent().get())->Args()[1]->Type() ==
+          NodeType::OR);
+    REQUIRE(if_expr.Alternative()->Type() == NodeType::DEFINE);
+    CHECK(static_cast<AssignExpr*>(if_expr.Alternative().get())->Value()->Type() ==
+          NodeType::QUOTE);
+
+    CHECK(resolver.Resolve(parser.Parse())->Type() == NodeType::SET);
+    CHECK(resolver.Resolve(parser.Parse())->Type() == NodeType::CALL);
+}
+
+TEST_CASE("FolderComputesConstantCalls") {
+    std::stringstream in("(lambda (x) (if #t (+ x (* 3 4) (- 1)) (f)) (+ 1 (* 2 3)) (+ 1 x))");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    auto scope = std::make_shared<Scope>();
+    scope->AddName("+", ValueType(NodePtr(new Plus())));
+    scope->AddName("-", ValueType(NodePtr(new Minus())));
+    scope->AddName("*", ValueType(NodePtr(new Mult())));
+    scope->AddName("<", ValueType(NodePtr(new Less())));
+    auto node = ConstantFolder(scope).Fold(Resolver().Resolve(parser.Parse()));
+    REQUIRE(node->Type() == NodeType::LAMBDA_EXPR);
+    auto& body = static_cast<LambdaExpr*>(node.get())->Body().Elements();
+    REQUIRE(body.size() == 3);
+
+    REQUIRE(body[0]->Type() == NodeType::CALL);
+    auto& args = static_cast<CallExpr*>(body[0].get())->Args();
+    CHECK(args[0]->Type() == NodeType::LOCAL_VAR);
+    CHECK(args[1]->Type() == NodeType::FOLDED);
+    CHECK(args[2]->Type() == NodeType::FOLDED);
+
+    REQUIRE(body[1]->Type() == NodeType::FOLDED);
+    auto folded = static_cast<FoldedExpr*>(body[1].get());
+    CHECK(folded->Value().AsInt() == 7);
+    CHECK(folded->Guards().size() == 2);
+    CHECK(body[2]->Type() == NodeType::CALL);
+
+    auto code = Compiler().Compile(body[1]);
+    CHECK(Disassemble(*code) ==
+          "0 FOLDED (+ 1 (* 2 3))\n"
+          "1 JUMP 11\n"
+          "2 LOAD_GLOBAL +\n"
+          "3 CONST 1\n"
+          "4 FOLDED (* 2 3)\n"
+          "5 JUMP 10\n"
+          "6 LOAD_GLOBAL *\n"
+          "7 CONST 2\n"
+          "8 CONST 3\n"
+          "9 CALL 2\n"
+          "10 TAIL_CALL 2\n"
+          "11 RETURN\n");
+}
+
+TEST_CASE_METHOD(HeapTest, "FolderChoosesBranchOfFoldedTest") {
+    std::stringstream in("(lambda (x) (if (< 1 2) 3 4) (if (< 2 1) x) (if (< 1 2) x (car x)))");
+    Parser parser(std::make_shared<Tokenizer>(&in));
+    auto node = ConstantFolder(scope).Fold(Resolver().Resolve(parser.Parse()));
+    REQUIRE(node->Type() == NodeType::LAMBDA_EXPR);
+    auto& body = static_cast<LambdaExpr*>(node.get())->Body().Elements();
+    REQUIRE(body.size() == 3);
+
+    REQUIRE(body[0]->Type() == NodeType::FOLDED);
+    auto folded = static_cast<FoldedExpr*>(body[0].get());
+    CHECK(folded->Value().AsInt() == 3);
+    CHECK(!folded->Taken());
+    CHECK(folded->Original()->Type() == NodeType::IF);
+
+    REQUIRE(body[1]->Type() == NodeType::FOLDED);
+    CHECK(static_cast<FoldedExpr*>(body[1].get())->Value().ToString() == "()");
+
+    REQUIRE(body[2]->Type() == NodeType::FOLDED);
+    folded = static_cast<FoldedExpr*>(body[2].get());
+    REQUIRE(folded->Taken());
+    CHECK(folded->Taken()->Type() == NodeType::LOCAL_VAR);
+    CHECK(folded->Guards().size() == 1);
+
+    auto code = Compiler().Compile(node);
+    // while the guard holds the jump leads past the original if
+    auto listing = Disassemble(*code->functions[0]);
+    CHECK(listing.substr(listing.find("26 FOLDED")) ==
+          "26 FOLDED if\n"
+          "27 JUMP 41\n"
+          "28 FOLDED (< 1 2)\n"
+          "29 JUMP 34\n"
+          "30 LOAD_GLOBAL <\n"
+          "31 CONST 1\n"
+          "32 CONST 2\n"
+          "33 CALL 2\n"
+          "34 JUMP_IF_FALSE 37\n"
+          "35 LOAD_LOCAL 0 0 x\n"
+          "36 JUMP 40\n"
+          "37 LOAD_GLOBAL car\n"
+          "38 LOAD_LOCAL 0 0 x\n"
+          "39 TAIL_CALL 1\n"
+          "40 JUMP 43\n"
+          "41 POP\n"
+          "42 LOAD_LOCAL 0 0 x\n"
+          "43 RETURN\n");
+}
+
+TEST_CASE_METHOD(LispTest, "FoldedCallsObserveRedefinition") {
+    ExpectNoError("(define (f) (+ 1 (* 2 3)))");
+    ExpectEq("(f)", "7");
+    ExpectEq("(if (< 1 2) 'yes 'no)", "yes");
+    ExpectEq("(if #f 'yes)", "()");
+
+    ExpectNoError("(define (g) (set! * +) (+ 1 (* 2 3)))");
+    ExpectEq("(g)", "6");
+    ExpectEq("(f)", "6");
+
+    ExpectNoError("(define + -)");
+    ExpectEq("(f)", "-4");
+
+    ExpectNoError("(define (h) (/ 1 0))");
+    ExpectRuntimeError("(h)");
+}
+
+TEST_CASE_METHOD(LispTest, "FoldedTestsObserveRedefinition") {
+    ExpectNoError("(define (k x) (if (< 1 2) (+ x 1) (car x)))");
+    ExpectEq("(k 1)", "2");
+    ExpectNoError("(define (loop n) (if (< 1 2) (if (= n 0) 'done (loop (- n 1))) 'no))");
+    ExpectEq("(loop 100000)", "done");
+
+    ExpectNoError("(define < >)");
+    ExpectRuntimeError("(k 1)");
+    ExpectEq("(k '(5))", "5");
+    ExpectEq("(loop 100000)", "no");
+}